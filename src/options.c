@@ -64,7 +64,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #endif
 
 static char defaultOutputFile[] = "%Y-%m-%d-%H%M%S_$wx$h_scrot.$F";
-struct ScrotOptions opt = {
+static const struct ScrotOptions defaultOptions = {
     .quality = 75,
     .compression = 7,
     .lineStyle = LineSolid,
@@ -72,12 +72,25 @@ struct ScrotOptions opt = {
     .stackDirection = HORIZONTAL,
     .outputFile = defaultOutputFile,
     .lineColor = "gray",
+    .burst = 1,
+    .changeDelay = 100,
+    .fps = 30,
 };
+struct ScrotOptions opt;
 
 enum { /* long opt only */
     /* ensure these don't collide with single byte opts. */
     OPT_FORMAT = UCHAR_MAX + 1,
     OPT_LIST_OPTS,
+    OPT_BURST,
+    OPT_INTERVAL,
+    OPT_ON_CHANGE,
+    OPT_DAEMON,
+    OPT_CLIENT,
+    OPT_COMPOSITE,
+    OPT_SNAP,
+    OPT_STREAM,
+    OPT_FPS,
 };
 static const char stropts[] = "a:bC:cD:d:e:F:fhik::l:M:mopq:s::t:uvw:Z:z";
 // NOTE: make sure lopts and opt_description indexes are kept in sync
@@ -111,6 +124,15 @@ static const struct option lopts[] = {
     {"silent",          no_argument,        NULL,   'z'},
     {"format",          required_argument,  NULL, OPT_FORMAT},
     {"list-options",    optional_argument,  NULL, OPT_LIST_OPTS},
+    {"burst",           required_argument,  NULL, OPT_BURST},
+    {"interval",        required_argument,  NULL, OPT_INTERVAL},
+    {"on-change",       optional_argument,  NULL, OPT_ON_CHANGE},
+    {"daemon",          optional_argument,  NULL, OPT_DAEMON},
+    {"client",          optional_argument,  NULL, OPT_CLIENT},
+    {"composite",       no_argument,        NULL, OPT_COMPOSITE},
+    {"snap",            optional_argument,  NULL, OPT_SNAP},
+    {"stream",          required_argument,  NULL, OPT_STREAM},
+    {"fps",             required_argument,  NULL, OPT_FPS},
     {0}
 };
 static const char OPT_DEPRECATED[] = "";
@@ -130,7 +152,7 @@ static const struct option_desc {
     /* i */  { "ignore keyboard", "" },
     /* k */  { "capture overlapped window and join them", "v|h" },
     /* l */  { "specify the style of the selection line", "STYLE" },
-    /* M */  { "capture monitor", "NUM" },
+    /* M */  { "capture monitor NUM, or each one with \"all\"", "NUM" },
     /* m */  { "capture all multi-head screens in order", "" },
     /* o */  { "overwrite the output file if needed", "" },
     /* p */  { "capture the mouse pointer as well", "" },
@@ -145,6 +167,15 @@ static const struct option_desc {
     /* z */  { "prevent beeping", "" },
     /* OPT_FORMAT */     { "specify output file format", "FMT" },
     /* OPT_LIST_OPTS */  { "list all options", "human|tsv" },
+    /* OPT_BURST */      { "take NUM shots, 0 means until interrupted", "NUM" },
+    /* OPT_INTERVAL */   { "time between shots taken with --burst", "MS" },
+    /* OPT_ON_CHANGE */  { "only take a shot when the screen changes", "MS" },
+    /* OPT_DAEMON */     { "serve shot requests from --client", "SOCKET" },
+    /* OPT_CLIENT */     { "ask a running --daemon to take the shot", "SOCKET" },
+    /* OPT_COMPOSITE */  { "grab windows without raising them", "" },
+    /* OPT_SNAP */       { "snap the selection to window edges", "PX" },
+    /* OPT_STREAM */     { "stream raw frames to stdout", "y4m|bgra" },
+    /* OPT_FPS */        { "frame rate of --stream", "NUM" },
 };
 
 static void showUsage(void);
@@ -217,6 +248,8 @@ static void optionsParseStack(const char *optarg)
         opt.stackDirection = HORIZONTAL;
     else if (strcmp(optarg, "v") == 0)
         opt.stackDirection = VERTICAL;
+    else if (strcmp(optarg, "f") == 0)
+        opt.stackFiles = true;
     else {
         errx(EXIT_FAILURE, "option --stack: Unknown value for suboption '%s'",
              optarg);
@@ -364,7 +397,10 @@ void optionsParse(int argc, char *argv[])
 {
     int optch;
     const char *errmsg;
-    bool FFlagSet = false;
+    bool FFlagSet = false, burstSet = false;
+
+    /* start from scratch, --daemon parses the options of every request */
+    opt = defaultOptions;
 
     /* Now to pass some optionarinos */
     while ((optch = getopt_long(argc, argv, stropts, lopts, NULL)) != -1) {
@@ -383,7 +419,11 @@ void optionsParse(int argc, char *argv[])
             opt.countdown = true;
             break;
         case 'D':
-            opt.display = optarg;
+            if (!opt.display)
+                opt.display = optarg;
+            opt.displays = erealloc(opt.displays,
+                (opt.displayCount + 1) * sizeof(*opt.displays));
+            opt.displays[opt.displayCount++] = optarg;
             break;
         case 'd':
             opt.delaySelection = *optarg == 'b';
@@ -421,6 +461,10 @@ void optionsParse(int argc, char *argv[])
             break;
         case 'M':
             opt.mode = MODE_MONITOR;
+            if (strcmp(optarg, "all") == 0) {
+                opt.monitor = MONITOR_ALL;
+                break;
+            }
             opt.monitor = optionsParseNum(optarg, 0, INT_MAX, &errmsg);
             if (errmsg) {
                 errx(EXIT_FAILURE, "option --monitor: '%s' is %s", optarg,
@@ -487,6 +531,67 @@ void optionsParse(int argc, char *argv[])
                     "unknown argument for --list-options: `%s`", optarg);
             }
             break;
+        case OPT_BURST:
+            opt.burst = optionsParseNum(optarg, 0, INT_MAX, &errmsg);
+            burstSet = true;
+            if (errmsg) {
+                errx(EXIT_FAILURE, "option --burst: '%s' is %s", optarg,
+                    errmsg);
+            }
+            break;
+        case OPT_INTERVAL:
+            opt.interval = optionsParseNum(optarg, 0, INT_MAX, &errmsg);
+            if (errmsg) {
+                errx(EXIT_FAILURE, "option --interval: '%s' is %s", optarg,
+                    errmsg);
+            }
+            break;
+        case OPT_ON_CHANGE:
+            opt.onChange = true;
+            if (!optarg) /* the coalescing delay is optional */
+                break;
+            opt.changeDelay = optionsParseNum(optarg, 0, INT_MAX, &errmsg);
+            if (errmsg) {
+                errx(EXIT_FAILURE, "option --on-change: '%s' is %s", optarg,
+                    errmsg);
+            }
+            break;
+        case OPT_DAEMON:
+            opt.daemon = true;
+            opt.socketPath = optarg;
+            break;
+        case OPT_CLIENT:
+            opt.client = true;
+            opt.socketPath = optarg;
+            break;
+        case OPT_COMPOSITE:
+            opt.composite = true;
+            break;
+        case OPT_STREAM:
+            if (strcmp(optarg, "y4m") == 0)
+                opt.stream = STREAM_Y4M;
+            else if (strcmp(optarg, "bgra") == 0)
+                opt.stream = STREAM_BGRA;
+            else
+                errx(EXIT_FAILURE, "option --stream: unknown value '%s'", optarg);
+            break;
+        case OPT_FPS:
+            opt.fps = optionsParseNum(optarg, 1, 1000, &errmsg);
+            if (errmsg) {
+                errx(EXIT_FAILURE, "option --fps: '%s' is %s", optarg,
+                    errmsg);
+            }
+            break;
+        case OPT_SNAP:
+            opt.snap = 8; /* the default distance */
+            if (!optarg)
+                break;
+            opt.snap = optionsParseNum(optarg, 1, INT_MAX, &errmsg);
+            if (errmsg) {
+                errx(EXIT_FAILURE, "option --snap: '%s' is %s", optarg,
+                    errmsg);
+            }
+            break;
         default:
             exit(EXIT_FAILURE);
         }
@@ -501,6 +606,46 @@ void optionsParse(int argc, char *argv[])
     for (; *argv; ++argv)
         warnx("ignoring extraneous non-option argument: %s", *argv);
 
+    if (opt.burst != 1 && opt.mode == MODE_SELECT)
+        errx(EXIT_FAILURE, "option --burst: can't be used with --select");
+    if (opt.onChange && opt.mode == MODE_SELECT)
+        errx(EXIT_FAILURE, "option --on-change: can't be used with --select");
+    if (!burstSet && !opt.stream) {
+        if (opt.onChange)
+            errx(EXIT_FAILURE, "option --on-change: only works with --burst");
+        if (opt.interval)
+            errx(EXIT_FAILURE, "option --interval: only works with --burst");
+    }
+    if (opt.displayCount > 1 && opt.mode != MODE_SCREEN) {
+        errx(EXIT_FAILURE, "option --display: given more than once, it only "
+            "works for full screen shots");
+    }
+    if (opt.displayCount > 1 && opt.onChange)
+        errx(EXIT_FAILURE, "option --on-change: can't be used with several -D");
+    if (opt.displayCount > 1 && opt.pointer)
+        errx(EXIT_FAILURE, "option --pointer: can't be used with several -D");
+    if (opt.daemon && opt.client)
+        errx(EXIT_FAILURE, "option --daemon: can't be used with --client");
+    if (opt.stream) {
+        if (opt.mode == MODE_SELECT)
+            errx(EXIT_FAILURE, "option --stream: can't be used with --select");
+        /* each of these makes several images per shot */
+        if (opt.displayCount > 1)
+            errx(EXIT_FAILURE, "option --stream: can't be used with several -D");
+        if (opt.mode == MODE_STACK && opt.stackFiles)
+            errx(EXIT_FAILURE, "option --stream: can't be used with --stack=f");
+        if (opt.mode == MODE_MONITOR && opt.monitor == MONITOR_ALL) {
+            errx(EXIT_FAILURE, "option --stream: can't be used with "
+                "--monitor all");
+        }
+        if (opt.onChange || opt.interval)
+            errx(EXIT_FAILURE, "option --stream: paced by --fps, can't be "
+                "used with --on-change or --interval");
+        /* streams run until interrupted unless told otherwise */
+        if (!burstSet)
+            opt.burst = 0;
+    }
+
     if (!opt.format) {
         char *ext;
         size_t extLength = scrotHaveFileExtension(opt.outputFile, &ext);
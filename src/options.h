@@ -61,6 +61,14 @@ enum ShotMode {
     MODE_SELECT,
 };
 
+enum { MONITOR_ALL = -1 }; /* opt.monitor for --monitor all */
+
+enum StreamFormat {
+    STREAM_NONE,
+    STREAM_Y4M,
+    STREAM_BGRA,
+};
+
 struct ScrotOptions {
     enum ShotMode mode;
     int delay;
@@ -82,6 +90,9 @@ struct ScrotOptions {
     char *thumbFile;
     const char *exec;
     const char *display;
+    const char **displays; /* every -D, when given more than once */
+    int displayCount;
+    const char *socketPath;
     Window windowId;
     const char *windowClassName;
     int autoselectX;
@@ -90,6 +101,12 @@ struct ScrotOptions {
     int autoselectW;
     SelectionMode selection;
     int monitor;
+    int burst;
+    int interval;
+    int changeDelay;
+    int snap;
+    enum StreamFormat stream;
+    int fps;
     bool delaySelection;
     bool countdown;
     bool border;
@@ -98,6 +115,11 @@ struct ScrotOptions {
     bool overwrite;
     bool freeze;
     bool ignoreKeyboard;
+    bool onChange;
+    bool daemon;
+    bool client;
+    bool composite;
+    bool stackFiles;
 };
 
 extern struct ScrotOptions opt;
@@ -49,6 +49,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <err.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -65,10 +66,36 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "options.h"
 #include "scrot.h"
+#include "scrot_convert.h"
+#include "scrot_daemon.h"
+#include "scrot_damage.h"
+#include "scrot_format.h"
+#include "scrot_query.h"
+#include "scrot_shm.h"
+#include "scrot_stream.h"
 #include "util.h"
 
+/* a drawable to be grabbed into an image buffer by scrotGrabParts() */
+struct ConcatPart {
+    Display *dpy; /* NULL to go through the worker's connection to `disp` */
+    Drawable drawable;
+    int w, h;
+    uint32_t *dst; /* rows are `stride` pixels apart */
+    int stride;
+    XImage *ximage; /* kept when scrotConvertXImageTo() can't handle it */
+    bool failed; /* reported by scrotGrabParts(), not on the worker thread */
+};
+
 static void initXAndImlib(const char *, int);
 static void uninitXAndImlib(void);
+static void scrotLoadImlibSavers(void);
+static Imlib_Image scrotGrabImage(void);
+static void scrotSaveShot(Imlib_Image);
+static void scrotSaveFiles(Imlib_Image, struct tm *);
+static void scrotSaveMonitors(Imlib_Image, struct tm *);
+static void scrotSaveStackWindows(Imlib_Image, struct tm *);
+static void scrotSaveDisplays(Imlib_Image, struct tm *);
+static Imlib_Image scrotGrabDisplays(void);
 static void scrotSaveImage(int, const char *);
 static Imlib_Image scrotGrabFocused(void);
 static Imlib_Image scrotGrabAutoselect(void);
@@ -83,8 +110,8 @@ static char *imPrintf(const char *, struct tm *, const char *, const char *,
     Imlib_Image);
 static char *scrotGetWindowName(Window);
 static Window scrotGetClientWindow(Display *, Window);
-static Window scrotFindWindowByProperty(Display *, const Window, const Atom);
-static Imlib_Image stalkImageConcat(Imlib_Image *, size_t, const enum Direction);
+static Imlib_Image stalkImageConcat(struct ConcatPart *, size_t,
+    const enum Direction);
 static int findWindowManagerFrame(Window *const, int *const);
 static Imlib_Image scrotGrabWindowById(Window const window);
 
@@ -94,54 +121,193 @@ Window root;
 Window clientWindow;
 Screen *scr;
 
+static struct ShmImage shmImage;
+/* Xlib connections can't be shared by threads, each worker gets its own. The
+ * first one is always `disp`, for the calling thread. */
+static Display **workerDisp;
+static int workerDispCount;
+/* several -D: the screen of each display, grabbed concurrently */
+struct DisplayShot {
+    const char *name;
+    Display *dpy;
+    struct ConcatPart part;
+    Imlib_Image image;
+    bool failed; /* couldn't connect, reported by scrotGrabDisplays() */
+};
+static struct {
+    struct DisplayShot *list;
+    size_t count;
+} displayShots;
+/* display being saved, for the $D specifier */
+static const char *shotDisplay;
+/* --stack=f: windows grabbed besides the one returned by the grab */
+static struct {
+    Imlib_Image *images;
+    Window *windows;
+    size_t count;
+} stackShots;
+static bool compositeError;
+static long frameNumber;
+/* area covered by the last shot, used to filter --on-change damage */
+static XRectangle shotArea;
+/* area of the root window the pointer was last drawn over */
+static XRectangle pointerArea;
+/* monitor being saved, for the $M and $O specifiers */
+static struct {
+    int index;
+    char *name;
+} shotMonitor = { -1, NULL };
+
+/* With --burst, the previous frame is kept and only the parts of it that were
+ * damaged since are grabbed again. */
+static struct {
+    bool enabled;
+    Imlib_Image frame;
+    XRectangle area;
+    XRectangle *damage;
+    int damageCount;
+} incremental;
+
 int main(int argc, char *argv[])
 {
-    Imlib_Image image = NULL;
-    Imlib_Image thumbnail;
-    char *filenameIM = NULL;
-    char *filenameThumb = NULL;
-    struct timespec timeStamp;
-    struct tm *tm;
-    int fd;
-
     /* Get the time ASAP to reduce the timing error in case --delay is used. */
-    opt.delayStart = clockNow();
+    struct timespec start = clockNow();
 
+    /* Displays are opened and grabbed from worker threads, which older
+     * versions of Xlib only allow once this was called, before any other
+     * Xlib call. */
+    if (!XInitThreads())
+        errx(EXIT_FAILURE, "Xlib doesn't support threads");
     atexit(uninitXAndImlib);
 
     optionsParse(argc, argv);
+    opt.delayStart = start;
 
-    initXAndImlib(opt.display, 0);
-
-    if (opt.mode == MODE_SELECT)
-        image = scrotSelectionSelectMode();
-    else {
-
-        scrotDoDelay();
-
-        if (opt.mode == MODE_FOCUSED)
-            image = scrotGrabFocused();
-        else if (opt.mode == MODE_MULTIDISP)
-            image = scrotGrabShotMulti();
-        else if (opt.mode == MODE_STACK)
-            image = scrotGrabStackWindows();
-        else if (opt.mode == MODE_MONITOR)
-            image = scrotGrabShotMonitor();
-        else if (opt.mode == MODE_AUTOSEL)
-            image = scrotGrabAutoselect();
-        else if (opt.mode == MODE_WINDOW)
-            image = scrotGrabWindowById(opt.windowId);
-        else if (opt.mode == MODE_SCREEN)
-            image = scrotGrabShot();
-        else
-            scrotAssert(!"unreachable");
+    if (opt.client) {
+        int status = scrotDaemonClient(argc, argv);
+        if (status >= 0)
+            return status;
+        warnx("no daemon is listening, taking the shot locally");
     }
+
+    if (opt.daemon) {
+        /* loaded once here, the forked workers inherit them */
+        scrotLoadImlibSavers();
+        /* only returns in a worker, which connects ahead of the request */
+        scrotDaemonRun();
+        initXAndImlib(opt.display, 0);
+        scrotDaemonReceive();
+        opt.delayStart = clockNow();
+        if (opt.daemon)
+            errx(EXIT_FAILURE, "option --daemon: can't be sent by --client");
+        /* the client's -D or $DISPLAY may not be the daemon's */
+        if (opt.display && strcmp(opt.display, DisplayString(disp)) != 0) {
+            uninitXAndImlib();
+            initXAndImlib(opt.display, 0);
+        }
+    } else {
+        initXAndImlib(opt.display, 0);
+    }
+
+    if (opt.mode == MODE_SELECT) {
+        Imlib_Image image = scrotSelectionSelectMode();
+        scrotSaveShot(image);
+        imlib_context_set_image(image);
+        imlib_free_image_and_decache();
+        scrotDaemonReply();
+        return 0;
+    }
+
+    scrotDoDelay();
+
+    bool trackDamage = false;
+    /* several -D don't use the damage of the first display */
+    if (opt.burst != 1 && opt.displayCount < 2) {
+        trackDamage = scrotDamageInit();
+        if (!trackDamage && opt.onChange)
+            errx(EXIT_FAILURE, "option --on-change: XDamage is not available");
+        incremental.enabled = trackDamage;
+    }
+
+    /* With --burst, keep the display connection, the Imlib2 context and the
+     * SHM segment around and just repeat the grab. */
+    struct timespec frameStart = clockNow();
+    for (;;) {
+        shotArea = (XRectangle){ 0, 0, scr->width, scr->height };
+        if (trackDamage) {
+            if (incremental.damage)
+                XFree(incremental.damage);
+            incremental.damage = scrotDamageTake(&incremental.damageCount);
+        }
+        Imlib_Image image = scrotGrabImage();
+        if (opt.stream) {
+            if (!image)
+                errx(EXIT_FAILURE, "no image grabbed");
+            imlib_context_set_image(image);
+            scrotStreamFrame(imlib_image_get_data_for_reading_only(),
+                imlib_image_get_width(), imlib_image_get_height());
+        } else {
+            scrotSaveShot(image);
+        }
+        if (image != incremental.frame) {
+            imlib_context_set_image(image);
+            imlib_free_image_and_decache();
+        }
+        if (opt.burst != 0 && ++frameNumber >= opt.burst)
+            break;
+        if (opt.stream) {
+            scrotStreamWait();
+            continue;
+        }
+        frameStart = scrotSleepFor(frameStart, opt.interval);
+        if (opt.onChange) {
+            scrotDamageWait(&shotArea, opt.changeDelay);
+            frameStart = clockNow();
+        }
+    }
+
+    scrotDaemonReply();
+    return 0;
+}
+
+static Imlib_Image scrotGrabImage(void)
+{
+    Imlib_Image image = NULL;
+
+    if (opt.mode == MODE_FOCUSED)
+        image = scrotGrabFocused();
+    else if (opt.mode == MODE_MULTIDISP)
+        image = scrotGrabShotMulti();
+    else if (opt.mode == MODE_STACK)
+        image = scrotGrabStackWindows();
+    else if (opt.mode == MODE_MONITOR)
+        image = scrotGrabShotMonitor();
+    else if (opt.mode == MODE_AUTOSEL)
+        image = scrotGrabAutoselect();
+    else if (opt.mode == MODE_WINDOW)
+        image = scrotGrabWindowById(opt.windowId);
+    else if (opt.mode == MODE_SCREEN && opt.displayCount > 1)
+        image = scrotGrabDisplays();
+    else if (opt.mode == MODE_SCREEN)
+        image = scrotGrabShot();
+    else
+        scrotAssert(!"unreachable");
+    return image;
+}
+
+/* Save the grabbed image along with its thumbnail and run --exec on it. */
+static void scrotSaveShot(Imlib_Image image)
+{
+    struct timespec timeStamp;
+    struct tm *tm;
+
     if (!image)
         errx(EXIT_FAILURE, "no image grabbed");
 
     /* Get the time right after the screenshot.
-     * Don't put any new code between this clock_gettime() call and the
-     * screenshot-taking above or it will skew the timing.
+     * Callers must grab the image right before calling this function, don't
+     * put any new code before this clock_gettime() call or it will skew the
+     * timing.
      */
     clock_gettime(CLOCK_REALTIME, &timeStamp);
     if (timeStamp.tv_nsec >= miliToNanoSec(500)) {
@@ -155,6 +321,126 @@ int main(int argc, char *argv[])
         XFlush(disp);
     }
 
+    if (opt.mode == MODE_MONITOR && opt.monitor == MONITOR_ALL)
+        scrotSaveMonitors(image, tm);
+    else if (opt.mode == MODE_STACK && opt.stackFiles)
+        scrotSaveStackWindows(image, tm);
+    else if (opt.displayCount > 1)
+        scrotSaveDisplays(image, tm);
+    else
+        scrotSaveFiles(image, tm);
+}
+
+/* Size of the thumbnail of a w * h image, as requested with -t. */
+static void scrotThumbnailSize(int w, int h, int *twidth, int *theight)
+{
+    if (opt.thumb == THUMB_RES) {
+        *twidth = opt.thumbW;
+        *theight = opt.thumbH;
+        if (*twidth == 0)
+            *twidth = w * opt.thumbH / h;
+        else if (*theight == 0)
+            *theight = h * opt.thumbW / w;
+    } else {
+        *twidth = w * opt.thumbPercent / 100;
+        *theight = h * opt.thumbPercent / 100;
+    }
+    /* twidth and theight could be rounded to 0 for extremely small sizes,
+     * fix them up.
+     */
+    *twidth = MAX(*twidth, 1);
+    *theight = MAX(*theight, 1);
+}
+
+/* One of the files scrotSaveWithThumbnail() writes on its own thread. Only
+ * pixels are touched there, Imlib2 isn't thread safe. */
+struct SaveJob {
+    ImageWriter *writer;
+    const uint32_t *src;
+    int srcW, srcH;
+    /* the thumbnail is scaled from src to dst first, NULL for the image */
+    uint32_t *dst;
+    int w, h;
+    bool hasAlpha;
+    int fd;
+    bool ok;
+    int errnum;
+};
+
+static void scrotSaveJob(void *ctx, size_t i, int worker)
+{
+    struct SaveJob *jobs = ctx;
+    struct SaveJob *job = &jobs[i];
+    const uint32_t *data = job->src;
+    (void)worker;
+
+    if (job->dst) {
+        scrotScaleImage(job->src, job->srcW, job->srcH, job->dst, job->w,
+            job->h);
+        data = job->dst;
+    }
+    job->ok = job->writer(job->fd, data, job->w, job->h, job->hasAlpha,
+        opt.compression, opt.quality);
+    job->errnum = errno;
+    if (close(job->fd) < 0 && job->ok) {
+        job->ok = false;
+        job->errnum = errno;
+    }
+}
+
+/* Save `image`, which is in context, to fd along with its thumbnail, for the
+ * formats scrot writes itself: the thumbnail is scaled and encoded while the
+ * image is. Returns the name of the thumbnail.
+ */
+static char *scrotSaveWithThumbnail(Imlib_Image image, int fd,
+    const char *filenameIM, struct tm *tm)
+{
+    const int w = imlib_image_get_width(), h = imlib_image_get_height();
+    const bool hasAlpha = imlib_image_has_alpha();
+    const uint32_t *data = imlib_image_get_data_for_reading_only();
+    int twidth, theight;
+    scrotThumbnailSize(w, h, &twidth, &theight);
+
+    Imlib_Image thumbnail = imlib_create_image(twidth, theight);
+    if (!thumbnail)
+        errx(EXIT_FAILURE, "unable to create thumbnail");
+    imlib_context_set_image(thumbnail);
+    imlib_image_set_has_alpha(hasAlpha);
+    imlib_image_set_format(opt.format);
+    char *filenameThumb = imPrintf(opt.thumbFile, tm, NULL, NULL, thumbnail);
+    const int thumbFd = scrotCheckIfOverwriteFile(&filenameThumb);
+    uint32_t *thumbData = imlib_image_get_data();
+
+    ImageWriter *writer = scrotFormatWriter(opt.format);
+    struct SaveJob jobs[] = {
+        { writer, data, w, h, NULL, w, h, hasAlpha, fd, false, 0 },
+        { writer, data, w, h, thumbData, twidth, theight, hasAlpha, thumbFd,
+            false, 0 },
+    };
+    parallelFor(ARRAY_COUNT(jobs), ARRAY_COUNT(jobs), scrotSaveJob, jobs);
+
+    imlib_image_put_back_data(thumbData);
+    imlib_free_image_and_decache();
+    imlib_context_set_image(image);
+
+    const char *const filenames[] = { filenameIM, filenameThumb };
+    for (size_t i = 0; i < ARRAY_COUNT(jobs); ++i) {
+        if (!jobs[i].ok) {
+            errno = jobs[i].errnum;
+            err(EXIT_FAILURE, "failed to save image: %s", filenames[i]);
+        }
+    }
+    return filenameThumb;
+}
+
+/* Save `image` along with its thumbnail and run --exec on it. */
+static void scrotSaveFiles(Imlib_Image image, struct tm *tm)
+{
+    Imlib_Image thumbnail;
+    char *filenameIM = NULL;
+    char *filenameThumb = NULL;
+    int fd;
+
     imlib_context_set_image(image);
     imlib_image_set_format(opt.format);
     imlib_image_attach_data_value("quality", NULL, opt.quality, NULL);
@@ -162,33 +448,20 @@ int main(int argc, char *argv[])
 
     filenameIM = imPrintf(opt.outputFile, tm, NULL, NULL, image);
     fd = scrotCheckIfOverwriteFile(&filenameIM);
-    scrotSaveImage(fd, filenameIM);
 
-    if (opt.thumb != THUMB_DISABLED) {
+    if (opt.thumb == THUMB_DISABLED || !scrotFormatWriter(opt.format))
+        scrotSaveImage(fd, filenameIM);
+    else
+        filenameThumb = scrotSaveWithThumbnail(image, fd, filenameIM, tm);
+
+    /* formats saved by Imlib2 get their thumbnail after the image */
+    if (opt.thumb != THUMB_DISABLED && !filenameThumb) {
         int cwidth, cheight;
         int twidth, theight;
 
         cwidth = imlib_image_get_width();
         cheight = imlib_image_get_height();
-
-        if (opt.thumb == THUMB_RES) {
-            twidth = opt.thumbW;
-            theight = opt.thumbH;
-            if (twidth == 0)
-                twidth = cwidth * opt.thumbH / cheight;
-            else if (theight == 0)
-                theight = cheight * opt.thumbW / cwidth;
-        } else {
-            twidth = cwidth * opt.thumbPercent / 100;
-            theight = cheight * opt.thumbPercent / 100;
-        }
-        /* twidth and theight could be rounded to 0 for extremely small sizes,
-         * fix them up.
-         */
-        if (twidth == 0)
-            twidth = 1;
-        if (theight == 0)
-            theight = 1;
+        scrotThumbnailSize(cwidth, cheight, &twidth, &theight);
 
         imlib_context_set_anti_alias(1);
         thumbnail = imlib_create_cropped_scaled_image(0, 0, cwidth, cheight,
@@ -208,12 +481,77 @@ int main(int argc, char *argv[])
     if (opt.exec)
         scrotExecApp(image, tm, filenameIM, filenameThumb);
 
-    imlib_context_set_image(image);
-    imlib_free_image_and_decache();
     free(filenameIM);
     free(filenameThumb);
+}
 
-    return 0;
+/* --monitor all: save each monitor of the full screen `image` to its own file.
+ * All of them come from the same grab, so they share the same instant.
+ */
+static void scrotSaveMonitors(Imlib_Image image, struct tm *tm)
+{
+    int numMonitors;
+    XRRMonitorInfo *monitors = XRRGetMonitors(disp, root, True, &numMonitors);
+    if (!monitors)
+        errx(EXIT_FAILURE, "XRRGetMonitors() failed");
+
+    for (int i = 0; i < numMonitors; ++i) {
+        XRRMonitorInfo *m = monitors + i;
+        int x = m->x, y = m->y, w = m->width, h = m->height;
+        scrotNiceClip(&x, &y, &w, &h);
+
+        imlib_context_set_image(image);
+        Imlib_Image crop = imlib_create_cropped_image(x, y, w, h);
+        if (!crop)
+            errx(EXIT_FAILURE, "failed to crop monitor %d", i);
+
+        shotMonitor.index = i;
+        shotMonitor.name = m->name ? XGetAtomName(disp, m->name) : NULL;
+        scrotSaveFiles(crop, tm);
+        if (shotMonitor.name)
+            XFree(shotMonitor.name);
+
+        imlib_context_set_image(crop);
+        imlib_free_image_and_decache();
+    }
+    shotMonitor.index = -1;
+    shotMonitor.name = NULL;
+    XRRFreeMonitors(monitors);
+}
+
+/* --stack=f: save `image` and the other windows grabbed along with it, each to
+ * its own file. */
+static void scrotSaveStackWindows(Imlib_Image image, struct tm *tm)
+{
+    for (size_t i = 0; i < stackShots.count; ++i) {
+        clientWindow = stackShots.windows[i];
+        if (i == 0) {
+            scrotSaveFiles(image, tm);
+        } else {
+            scrotSaveFiles(stackShots.images[i], tm);
+            imlib_context_set_image(stackShots.images[i]);
+            imlib_free_image_and_decache();
+        }
+    }
+    clientWindow = None;
+    stackShots.count = 0;
+}
+
+/* several -D: save the shot of each display to its own file. */
+static void scrotSaveDisplays(Imlib_Image image, struct tm *tm)
+{
+    for (size_t i = 0; i < displayShots.count; ++i) {
+        struct DisplayShot *shot = displayShots.list + i;
+        shotDisplay = shot->name;
+        scrotSaveFiles(shot->image, tm);
+        if (shot->image != image) {
+            imlib_context_set_image(shot->image);
+            imlib_free_image_and_decache();
+        }
+        shot->image = NULL;
+    }
+    shotDisplay = NULL;
+    displayShots.count = 0;
 }
 
 static void initXAndImlib(const char *dispStr, int screenNumber)
@@ -253,16 +591,53 @@ static void initXAndImlib(const char *dispStr, int screenNumber)
 /* atexit register func. */
 static void uninitXAndImlib(void)
 {
+    for (int i = 1; i < workerDispCount; ++i)
+        XCloseDisplay(workerDisp[i]);
+    workerDispCount = 0;
+    /* the first shot uses `disp` */
+    for (int i = 1; i < opt.displayCount && displayShots.list; ++i) {
+        if (displayShots.list[i].dpy)
+            XCloseDisplay(displayShots.list[i].dpy);
+    }
+    free(displayShots.list);
+    displayShots.list = NULL;
     if (disp) {
+        scrotShmDestroy(&shmImage, disp);
         XCloseDisplay(disp);
         disp = NULL;
     }
 }
 
-// save image to fd, filename only used for logging
-// fd will be closed after calling this function
+/* Imlib2 finds its savers by scanning its loader directory and opening the
+ * modules there, the first time an image is saved. No saver handles this
+ * format, so all of them are loaded looking for one. */
+static void scrotLoadImlibSavers(void)
+{
+    Imlib_Image image = imlib_create_image(1, 1);
+    if (!image)
+        return;
+    imlib_context_set_image(image);
+    imlib_image_set_format("scrot-none");
+    imlib_save_image("/dev/null");
+    imlib_free_image_and_decache();
+}
+
+/* Save the image in context to fd, which is closed. The formats scrot
+ * writes itself (see scrot_format.c) bypass Imlib2's savers. */
 static void scrotSaveImage(int fd, const char *filename)
 {
+    ImageWriter *writer = scrotFormatWriter(opt.format);
+    if (writer) {
+        const int w = imlib_image_get_width(), h = imlib_image_get_height();
+        const uint32_t *data = imlib_image_get_data_for_reading_only();
+        bool ok = writer(fd, data, w, h, imlib_image_has_alpha(),
+            opt.compression, opt.quality);
+        if (close(fd) < 0)
+            ok = false;
+        if (!ok)
+            err(EXIT_FAILURE, "failed to save image: %s", filename);
+        return;
+    }
     imlib_save_image_fd(fd, filename);
     int imErr = imlib_get_error();
     if (imErr) {
@@ -287,21 +662,197 @@ size_t scrotHaveFileExtension(const char *filename, char **ext)
     return strlen(*ext);
 }
 
+/* Grab a rectangle of the root window. MIT-SHM is used when the X server is
+ * local, otherwise the image is transferred through the X connection.
+ */
+Imlib_Image scrotGrabRect(int x, int y, int w, int h)
+{
+    Imlib_Image im = NULL;
+    XImage *ximage = scrotShmGetImage(&shmImage, disp, root,
+        DefaultVisualOfScreen(scr), DefaultDepthOfScreen(scr), x, y, w, h);
+    if (ximage) {
+        im = scrotConvertXImage(ximage);
+        if (!im)
+            im = imlib_create_image_from_ximage(ximage, NULL, 0, 0, w, h,
+                false);
+        XDestroyImage(ximage);
+    }
+    if (!im)
+        im = imlib_create_image_from_drawable(0, x, y, w, h, true);
+    return im;
+}
+
+/* Grab `r` (clipped to the area of the previous frame) and copy it over the
+ * previous frame.
+ */
+static void scrotRegrabRect(const XRectangle *r)
+{
+    const XRectangle *a = &incremental.area;
+    const int x0 = MAX(r->x, a->x);
+    const int y0 = MAX(r->y, a->y);
+    const int x1 = MIN(r->x + r->width, a->x + a->width);
+    const int y1 = MIN(r->y + r->height, a->y + a->height);
+    if (x1 <= x0 || y1 <= y0)
+        return;
+
+    const int w = x1 - x0, h = y1 - y0;
+    Imlib_Image part = scrotGrabRect(x0, y0, w, h);
+    if (!part)
+        errx(EXIT_FAILURE, "failed to grab image");
+    imlib_context_set_image(incremental.frame);
+    imlib_blend_image_onto_image(part, 0, 0, 0, w, h, x0 - a->x, y0 - a->y,
+        w, h);
+    imlib_context_set_image(part);
+    imlib_free_image();
+}
+
+/* Bring the previous frame up to date by grabbing only what was damaged since
+ * it was taken, along with the area the pointer was drawn over. The whole
+ * rectangle is grabbed if it differs from the previous one. The returned image
+ * is owned by `incremental` and must not be freed.
+ */
+static Imlib_Image scrotGrabRectIncremental(int x, int y, int w, int h)
+{
+    const XRectangle area = { x, y, w, h };
+    const XRectangle *prev = &incremental.area;
+
+    if (incremental.frame && (prev->x != area.x || prev->y != area.y
+        || prev->width != area.width || prev->height != area.height)) {
+        imlib_context_set_image(incremental.frame);
+        imlib_free_image_and_decache();
+        incremental.frame = NULL;
+    }
+    if (!incremental.frame) {
+        incremental.frame = scrotGrabRect(x, y, w, h);
+        incremental.area = area;
+        return incremental.frame;
+    }
+
+    imlib_context_set_blend(0);
+    for (int i = 0; i < incremental.damageCount; ++i)
+        scrotRegrabRect(&incremental.damage[i]);
+    if (opt.pointer)
+        scrotRegrabRect(&pointerArea);
+    imlib_context_set_blend(1);
+    return incremental.frame;
+}
+
 Imlib_Image scrotGrabRectAndPointer(int x, int y, int w, int h)
 {
-    Imlib_Image im = imlib_create_image_from_drawable(0, x, y, w, h, true);
+    Imlib_Image im = incremental.enabled ? scrotGrabRectIncremental(x, y, w, h)
+        : scrotGrabRect(x, y, w, h);
     if (!im)
         errx(EXIT_FAILURE, "failed to grab image");
+    shotArea = (XRectangle){ x, y, w, h };
     if (opt.pointer)
         scrotGrabMousePointer(im, x, y);
     return im;
 }
 
+static int compositeErrorHandler(Display *dpy, XErrorEvent *ev)
+{
+    (void)dpy;
+    (void)ev;
+    compositeError = true;
+    return 0;
+}
+
+/* --composite: grab `window` from the backing pixmap of its top-level window.
+ * That pixmap holds the contents of the window even where it's obscured, so
+ * there's no need to raise it and wait for the WM. Returns NULL if the pixmap
+ * can't be used.
+ */
+Imlib_Image scrotGrabWindowComposite(Window window)
+{
+    int major = 0, minor = 2; /* XCompositeNameWindowPixmap() needs 0.2 */
+    if (!XCompositeQueryVersion(disp, &major, &minor)
+        || (major == 0 && minor < 2))
+        return NULL;
+
+    /* Only a compositing manager keeps the windows redirected, so that their
+     * pixmaps hold what's covered. Redirecting them here would come too late
+     * for that. */
+    if (XGetSelectionOwner(disp, XInternAtom(disp, "_NET_WM_CM_S0", False))
+        == None) {
+        warnx("option --composite: no compositing manager is running, "
+            "raising the window instead");
+        opt.composite = false;
+        return NULL;
+    }
+
+    Window top = window, child;
+    int frames = 0;
+    if (window == root || !findWindowManagerFrame(&top, &frames))
+        return NULL;
+    Window target = opt.border ? top : scrotGetClientWindow(disp, top);
+
+    XWindowAttributes attr, topAttr;
+    if (!XGetWindowAttributes(disp, target, &attr)
+        || attr.map_state != IsViewable
+        || !XGetWindowAttributes(disp, top, &topAttr))
+        return NULL;
+
+    /* the pixmap covers the border of the top-level window too */
+    int x, y, w = attr.width, h = attr.height;
+    XTranslateCoordinates(disp, target, top, 0, 0, &x, &y, &child);
+    x += topAttr.border_width;
+    y += topAttr.border_width;
+    if (opt.border && frames < 2 && attr.border_width > 0) {
+        x -= attr.border_width;
+        y -= attr.border_width;
+        w += attr.border_width * 2;
+        h += attr.border_width * 2;
+    }
+
+    compositeError = false;
+    XErrorHandler oldHandler = XSetErrorHandler(compositeErrorHandler);
+    Pixmap pixmap = XCompositeNameWindowPixmap(disp, top);
+    XImage *ximage = XGetImage(disp, pixmap, x, y, w, h, AllPlanes, ZPixmap);
+    XFreePixmap(disp, pixmap);
+    XSync(disp, False);
+    XSetErrorHandler(oldHandler);
+    if (!ximage || compositeError) {
+        if (ximage)
+            XDestroyImage(ximage);
+        return NULL;
+    }
+
+    /* a pixmap has no visual, the masks have to come from the window it
+     * belongs to: the top-level one, whose visual can differ from target's */
+    ximage->red_mask = topAttr.visual->red_mask;
+    ximage->green_mask = topAttr.visual->green_mask;
+    ximage->blue_mask = topAttr.visual->blue_mask;
+    Imlib_Image im = scrotConvertXImage(ximage);
+    if (!im)
+        im = imlib_create_image_from_ximage(ximage, NULL, 0, 0, w, h, 1);
+    XDestroyImage(ximage);
+    if (!im)
+        return NULL;
+
+    int rx, ry;
+    XTranslateCoordinates(disp, top, root, x - topAttr.border_width,
+        y - topAttr.border_width, &rx, &ry, &child);
+    shotArea = (XRectangle){ rx, ry, w, h };
+    if (opt.pointer)
+        scrotGrabMousePointer(im, rx, ry);
+    return im;
+}
+
 static Imlib_Image scrotGrabWindowById(Window const window)
 {
     Imlib_Image im = NULL;
     int rx = 0, ry = 0, rw = 0, rh = 0;
 
+    if (opt.composite) {
+        if ((im = scrotGrabWindowComposite(window))) {
+            clientWindow = window;
+            return im;
+        }
+        if (opt.composite)
+            warnx("option --composite: couldn't use the window's pixmap");
+        opt.composite = false;
+    }
+
     if (!scrotGetGeometry(window, &rx, &ry, &rw, &rh))
         return NULL;
     scrotNiceClip(&rx, &ry, &rw, &rh);
@@ -456,13 +1007,16 @@ int scrotGetGeometry(Window target, int *rx, int *ry, int *rw, int *rh)
             if (!opt.border)
                 target = scrotGetClientWindow(disp, target);
 
-            XRaiseWindow(disp, target);
-            XSync(disp, False);
+            /* --composite doesn't care about what's covering the window */
+            if (!opt.composite) {
+                XRaiseWindow(disp, target);
+                XSync(disp, False);
 
-            /* HACK: there doesn't seem to be any way to figure out whether the
-             * raise request was accepted or rejected. so just sleep a bit to
-             * give the WM some time to update. */
-            scrotSleepFor(clockNow(), 160);
+                /* HACK: there doesn't seem to be any way to figure out whether
+                 * the raise request was accepted or rejected. so just sleep a
+                 * bit to give the WM some time to update. */
+                scrotSleepFor(clockNow(), 160);
+            }
         }
     }
     stat = XGetWindowAttributes(disp, target, &attr);
@@ -508,39 +1062,61 @@ Window scrotGetWindow(Display *display, Window window, int x, int y)
     return target;
 }
 
-void scrotGrabMousePointer(Imlib_Image image, const int xOffset,
-    const int yOffset)
+/* Return the current cursor image, positioned where the pointer is. The image
+ * is only fetched again once XFixes tells that the cursor changed, otherwise
+ * only the pointer's position is queried.
+ */
+static const XFixesCursorImage *scrotGetCursor(void)
 {
-    XFixesCursorImage *xcim = XFixesGetCursorImage(disp);
-    if (!xcim)
-        errx(EXIT_FAILURE, "Can't get the cursor from X");
-    const unsigned short width = xcim->width;
-    const unsigned short height = xcim->height;
-    const size_t pixcnt = (size_t)width*height;
+    static XFixesCursorImage *cached;
+    static Display *cachedDisp;
+    static int eventBase;
+
+    if (cachedDisp != disp) { /* e.g the daemon switched displays */
+        cached = NULL;
+        cachedDisp = disp;
+        XFixesQueryExtension(disp, &eventBase, &(int){0});
+        XFixesSelectCursorInput(disp, root, XFixesDisplayCursorNotifyMask);
+    }
+
+    XEvent ev;
+    bool changed = !cached;
+    while (XCheckTypedEvent(disp, eventBase + XFixesCursorNotify, &ev)) {
+        const XFixesCursorNotifyEvent *cev = (XFixesCursorNotifyEvent *)&ev;
+        changed |= !cached || cev->cursor_serial != cached->cursor_serial;
+    }
+
+    if (changed) {
+        if (cached)
+            XFree(cached);
+        cached = XFixesGetCursorImage(disp);
+        if (!cached)
+            errx(EXIT_FAILURE, "Can't get the cursor from X");
+        return cached;
+    }
 
-    uint32_t *pixels = (uint32_t *)xcim->pixels;
-    /* XFixesCursorImage returns pixels as `unsigned long`, which is typically
-     * 64bits, but imlib2 expects 32bit packed integers. */
-    if (sizeof *xcim->pixels > sizeof *pixels) {
-        for (size_t i = 0; i < pixcnt; ++i)
-            pixels[i] = xcim->pixels[i];
+    int x, y;
+    if (XQueryPointer(disp, root, &(Window){0}, &(Window){0}, &x, &y,
+        &(int){0}, &(int){0}, &(unsigned int){0})) {
+        cached->x = x;
+        cached->y = y;
     }
+    return cached;
+}
 
-    Imlib_Image imcursor = imlib_create_image_using_data(width, height, pixels);
-    if (!imcursor)
-        errx(EXIT_FAILURE, "Can't create cursor image");
+void scrotGrabMousePointer(Imlib_Image image, const int xOffset,
+    const int yOffset)
+{
+    const XFixesCursorImage *xcim = scrotGetCursor();
 
     /* Overlay the cursor into `image`. */
-    const int x = (xcim->x - xcim->xhot) - xOffset;
-    const int y = (xcim->y - xcim->yhot) - yOffset;
-    imlib_context_set_image(imcursor);
-    imlib_image_set_has_alpha(1);
+    pointerArea = (XRectangle){ xcim->x - xcim->xhot, xcim->y - xcim->yhot,
+        xcim->width, xcim->height };
     imlib_context_set_image(image);
-    imlib_blend_image_onto_image(imcursor, 0, 0, 0, width, height, x, y, width,
-        height);
-    imlib_context_set_image(imcursor);
-    imlib_free_image();
-    XFree(xcim);
+    uint32_t *data = imlib_image_get_data();
+    scrotBlendCursor(data, imlib_image_get_width(), imlib_image_get_height(),
+        xcim, pointerArea.x - xOffset, pointerArea.y - yOffset);
+    imlib_image_put_back_data(data);
 }
 
 static int scrotCheckIfOverwriteFile(char **filename)
@@ -594,24 +1170,6 @@ static int scrotCheckIfOverwriteFile(char **filename)
     return fd;
 }
 
-static int scrotMatchWindowClassName(Window target)
-{
-    scrotAssert(disp != NULL);
-    if (!opt.windowClassName)
-        return 1; /* Match any if the user hasn't requested a specific class. */
-
-    XClassHint clsHint;
-    int match = 0;
-
-    if (XGetClassHint(disp, target, &clsHint) != BadWindow) {
-        match = strcmp(clsHint.res_class, opt.windowClassName) == 0;
-        XFree(clsHint.res_name);
-        XFree(clsHint.res_class);
-    }
-
-    return match;
-}
-
 static Imlib_Image scrotGrabShot(void)
 {
     return scrotGrabRectAndPointer(0, 0, scr->width, scr->height);
@@ -720,9 +1278,26 @@ static char *imPrintf(const char *str, struct tm *tm, const char *filenameIM,
                 if (tmp)
                     streamStr(&ret, tmp);
                 break;
+            case 'i':
+                snprintf(buf, sizeof(buf), "%ld", frameNumber);
+                streamStr(&ret, buf);
+                break;
             case '$':
                 streamChar(&ret, '$');
                 break;
+            case 'D':
+                streamStr(&ret, shotDisplay ? shotDisplay : DisplayString(disp));
+                break;
+            case 'M':
+                if (shotMonitor.index >= 0) {
+                    snprintf(buf, sizeof(buf), "%d", shotMonitor.index);
+                    streamStr(&ret, buf);
+                }
+                break;
+            case 'O':
+                if (shotMonitor.name)
+                    streamStr(&ret, shotMonitor.name);
+                break;
             case 'W':
                 if (clientWindow && (tmp = scrotGetWindowName(clientWindow))) {
                     streamStr(&ret, tmp);
@@ -797,39 +1372,98 @@ static Window scrotGetClientWindow(Display *display, Window target)
     XFree(data);
     if ((status == Success) && (type != None))
         return target;
-    client = scrotFindWindowByProperty(display, target, state);
+    client = scrotQueryFindByProperty(display, target, state);
     if (!client)
         return target;
     return client;
 }
 
-static Window scrotFindWindowByProperty(Display *display, const Window window,
-    const Atom property)
+/* Make sure there are `n` connections for worker threads. */
+static void scrotWorkerDisplays(int n)
 {
-    Atom type = None;
-    int format, status;
-    unsigned char *data = NULL;
-    unsigned int i, numberChildren;
-    unsigned long after, numberItems;
-    Window child = None, *children, parent, rootReturn;
+    if (n > workerDispCount)
+        workerDisp = erealloc(workerDisp, n * sizeof(*workerDisp));
+    for (; workerDispCount < n; ++workerDispCount) {
+        Display *dpy = workerDispCount == 0 ? disp
+            : XOpenDisplay(DisplayString(disp));
+        if (!dpy)
+            errx(EXIT_FAILURE, "Can't open X display for worker thread");
+        workerDisp[workerDispCount] = dpy;
+    }
+}
 
-    status = XQueryTree(display, window, &rootReturn, &parent, &children,
-        &numberChildren);
-    if (!status)
-        return None;
-    for (i = 0; (i < numberChildren) && (child == None); i++) {
-        status = XGetWindowProperty(display, children[i], property, 0L, 0L, False,
-            AnyPropertyType, &type, &format,
-            &numberItems, &after, &data);
-        XFree(data);
-        if ((status == Success) && type)
-            child = children[i];
-    }
-    for (i = 0; (i < numberChildren) && (child == None); i++)
-        child = scrotFindWindowByProperty(display, children[i], property);
-    if (children != None)
-        XFree(children);
-    return (child);
+static void scrotGrabPart(void *ctx, size_t i, int worker)
+{
+    struct ConcatPart *part = (struct ConcatPart *)ctx + i;
+    Display *dpy = part->dpy ? part->dpy : workerDisp[worker];
+    XImage *ximage = XGetImage(dpy, part->drawable, 0, 0, part->w, part->h,
+        AllPlanes, ZPixmap);
+    if (!ximage) {
+        part->failed = true;
+        return;
+    }
+    if (scrotConvertXImageTo(ximage, part->dst, part->stride))
+        XDestroyImage(ximage);
+    else
+        part->ximage = ximage;
+}
+
+/* Grab each part into its buffer. The requests are sent over several
+ * connections at once and the pixels converted by a pool of threads. Imlib2
+ * isn't thread safe, so parts with an unusual visual are left to be converted
+ * here afterwards.
+ */
+static void scrotGrabParts(struct ConcatPart *parts, size_t partsCount)
+{
+    int workers = parallelWorkers(partsCount);
+    for (size_t i = 0; i < partsCount; ++i) {
+        if (!parts[i].dpy) {
+            scrotWorkerDisplays(workers);
+            break;
+        }
+    }
+    parallelFor(partsCount, workers, scrotGrabPart, parts);
+
+    for (size_t i = 0; i < partsCount; ++i) {
+        if (parts[i].failed) {
+            errx(EXIT_FAILURE, "failed to grab drawable 0x%lx",
+                parts[i].drawable);
+        }
+    }
+    for (size_t i = 0; i < partsCount; ++i) {
+        struct ConcatPart *part = parts + i;
+        if (!part->ximage)
+            continue;
+        Display *prevDisp = imlib_context_get_display();
+        Visual *prevVis = imlib_context_get_visual();
+        Colormap prevCm = imlib_context_get_colormap();
+        if (part->dpy) {
+            const int screen = DefaultScreen(part->dpy);
+            imlib_context_set_display(part->dpy);
+            imlib_context_set_visual(DefaultVisual(part->dpy, screen));
+            imlib_context_set_colormap(DefaultColormap(part->dpy, screen));
+        }
+        Imlib_Image im = imlib_create_image_from_ximage(part->ximage, NULL, 0,
+            0, part->w, part->h, 1);
+        imlib_context_set_display(prevDisp);
+        imlib_context_set_visual(prevVis);
+        imlib_context_set_colormap(prevCm);
+        if (!im) {
+            errx(EXIT_FAILURE, "failed to create Imlib2 image: "
+                "drawable 0x%lx", part->drawable);
+        }
+        Imlib_Image prev = imlib_context_get_image();
+        imlib_context_set_image(im);
+        const uint32_t *src = imlib_image_get_data_for_reading_only();
+        for (int row = 0; row < part->h; ++row) {
+            memcpy(part->dst + (size_t)row * part->stride,
+                src + (size_t)row * part->w, part->w * sizeof(*src));
+        }
+        imlib_free_image_and_decache();
+        imlib_context_set_image(prev);
+        XDestroyImage(part->ximage);
+        part->ximage = NULL;
+    }
 }
 
 static Imlib_Image scrotGrabStackWindows(void)
@@ -848,9 +1482,6 @@ static Imlib_Image scrotGrabStackWindows(void)
     Bool delete = False;
     int actualFormatReturn;
     Atom actualTypeReturn;
-    Imlib_Image im = NULL;
-    XImage *ximage = NULL;
-    XWindowAttributes attr;
     unsigned long i = 0;
     char EWMH_CLIENT_LIST[] = "_NET_CLIENT_LIST"; // spec EWMH
 
@@ -866,49 +1497,134 @@ static Imlib_Image scrotGrabStackWindows(void)
             EWMH_CLIENT_LIST);
     }
 
-    size_t imagesCount = 0;
-    Imlib_Image *images = erealloc(NULL, numberItemsReturn * sizeof(*images));
-
     if (!XCompositeQueryVersion(disp, &(int){0}, &(int){0}))
         errx(EXIT_FAILURE, "XCompositeQueryVersion() failed");
 
     XCompositeRedirectSubwindows(disp, root, CompositeRedirectAutomatic);
+    /* the workers' connections must see the redirection */
+    XSync(disp, False);
 
-    for (i = 0; i < numberItemsReturn; i++) {
-        Window win = *((Window *)propReturn + i);
+    const Window *clients = (Window *)propReturn;
+    struct WindowInfo *info = ecalloc(numberItemsReturn, sizeof(*info));
+    scrotQueryWindows(disp, clients, numberItemsReturn, opt.windowClassName,
+        info);
 
-        if (!XGetWindowAttributes(disp, win, &attr))
+    size_t partsCount = 0;
+    Window *windows = ecalloc(numberItemsReturn, sizeof(*windows));
+    struct ConcatPart *parts = ecalloc(numberItemsReturn, sizeof(*parts));
+    for (i = 0; i < numberItemsReturn; i++) {
+        if (!info[i].ok)
             errx(EXIT_FAILURE, "option --stack: Failed XGetWindowAttributes");
-
         /* Only visible windows */
-        if (attr.map_state != IsViewable)
-            continue;
-
-        if (!scrotMatchWindowClassName(win))
+        if (!info[i].isViewable || !info[i].isClassMatch)
             continue;
+        windows[partsCount] = clients[i];
+        parts[partsCount++] = (struct ConcatPart){
+            .drawable = clients[i], .w = info[i].w, .h = info[i].h
+        };
+    }
+    free(info);
+    XFree(propReturn);
 
-        ximage = XGetImage(disp, win, 0, 0, attr.width, attr.height, AllPlanes,
-            ZPixmap);
-
-        if (!ximage) {
-            errx(EXIT_FAILURE,
-                "option --stack: Failed XGetImage: Window id 0x%lx", win);
-        }
+    if (!opt.stackFiles) {
+        free(windows);
+        return stalkImageConcat(parts, partsCount, opt.stackDirection);
+    }
 
-        im = imlib_create_image_from_ximage(ximage, NULL, 0, 0,
-            attr.width, attr.height, 1);
-        if (!im) {
+    if (partsCount == 0) {
+        free(windows);
+        free(parts);
+        return NULL;
+    }
+    Imlib_Image *images = ecalloc(partsCount, sizeof(*images));
+    for (i = 0; i < partsCount; i++) {
+        struct ConcatPart *part = parts + i;
+        images[i] = imlib_create_image(part->w, part->h);
+        if (!images[i]) {
             errx(EXIT_FAILURE, "option --stack: "
-                "Failed to create Imlib2 image: Window id 0x%lx", win);
+                "Failed to create Imlib2 image: Window id 0x%lx", windows[i]);
         }
+        imlib_context_set_image(images[i]);
+        part->dst = imlib_image_get_data();
+        part->stride = part->w;
+    }
+    scrotGrabParts(parts, partsCount);
+    for (i = 0; i < partsCount; i++) {
+        imlib_context_set_image(images[i]);
+        imlib_image_put_back_data(parts[i].dst);
+        imlib_image_set_has_alpha(0);
+    }
+    free(parts);
+
+    free(stackShots.images);
+    free(stackShots.windows);
+    stackShots.images = images;
+    stackShots.windows = windows;
+    stackShots.count = partsCount;
+    return images[0];
+}
 
-        XDestroyImage(ximage);
+/* Runs on the workers, so failures are flagged instead of exiting. */
+static void scrotOpenDisplayShot(void *ctx, size_t i, int worker)
+{
+    (void)worker;
+    struct DisplayShot *shot = (struct DisplayShot *)ctx + i;
+    /* `disp` is already connected to the first -D */
+    shot->dpy = i == 0 ? disp : XOpenDisplay(shot->name);
+    if (!shot->dpy) {
+        shot->failed = true;
+        return;
+    }
+    Screen *screen = DefaultScreenOfDisplay(shot->dpy);
+    shot->part = (struct ConcatPart){
+        .dpy = shot->dpy,
+        .drawable = RootWindowOfScreen(screen),
+        .w = WidthOfScreen(screen),
+        .h = HeightOfScreen(screen),
+    };
+}
 
-        images[imagesCount++] = im;
+/* Several -D: grab the screen of each display. The displays are connected to
+ * and grabbed concurrently, each over its own connection. The first shot is
+ * returned, the others are saved along with it by scrotSaveDisplays().
+ */
+static Imlib_Image scrotGrabDisplays(void)
+{
+    const size_t count = opt.displayCount;
+    struct DisplayShot *list = displayShots.list;
+
+    /* the connections are kept around for --burst */
+    if (!list) {
+        list = displayShots.list = ecalloc(count, sizeof(*list));
+        for (size_t i = 0; i < count; ++i)
+            list[i].name = opt.displays[i];
+        parallelFor(count, parallelWorkers(count), scrotOpenDisplayShot, list);
+        for (size_t i = 0; i < count; ++i) {
+            if (list[i].failed)
+                errx(EXIT_FAILURE, "Can't open X display %s", list[i].name);
+        }
     }
-    XFree(propReturn);
 
-    return stalkImageConcat(images, imagesCount, opt.stackDirection);
+    struct ConcatPart *parts = ecalloc(count, sizeof(*parts));
+    for (size_t i = 0; i < count; ++i) {
+        parts[i] = list[i].part;
+        list[i].image = imlib_create_image(parts[i].w, parts[i].h);
+        if (!list[i].image)
+            errx(EXIT_FAILURE, "failed to create image for %s", list[i].name);
+        imlib_context_set_image(list[i].image);
+        parts[i].dst = imlib_image_get_data();
+        parts[i].stride = parts[i].w;
+    }
+    scrotGrabParts(parts, count);
+    for (size_t i = 0; i < count; ++i) {
+        imlib_context_set_image(list[i].image);
+        imlib_image_put_back_data(parts[i].dst);
+        imlib_image_set_has_alpha(0);
+    }
+    free(parts);
+
+    displayShots.count = count;
+    return list[0].image;
 }
 
 static Imlib_Image scrotGrabShotMulti(void)
@@ -917,39 +1633,27 @@ static Imlib_Image scrotGrabShotMulti(void)
     if (screens < 2)
         return scrotGrabShot();
 
-    int i;
-    char *dispStr;
-    char *subDisp;
-    char newDisp[255];
-    Imlib_Image ret = NULL;
-    size_t imagesCount = 0;
-    Imlib_Image *images = erealloc(NULL, screens * sizeof(*images));
-
-    subDisp = estrdup(DisplayString(disp));
-
-    for (i = 0; i < screens; i++) {
-        dispStr = strchr(subDisp, ':');
-        if (dispStr) {
-            dispStr = strchr(dispStr, '.');
-            if (dispStr)
-                *dispStr = '\0';
-        }
-        snprintf(newDisp, sizeof(newDisp), "%s.%d", subDisp, i);
-        initXAndImlib(newDisp, i);
-        ret = imlib_create_image_from_drawable(0, 0, 0, scr->width,
-            scr->height, 1);
-        if (!ret)
-            errx(EXIT_FAILURE, "failed to grab image");
-
-        images[imagesCount++] = ret;
+    /* The roots are grabbed concurrently by stalkImageConcat(), over the
+     * small pool of worker connections scrotGrabParts() keeps. */
+    struct ConcatPart *parts = erealloc(NULL, screens * sizeof(*parts));
+    for (int i = 0; i < screens; i++) {
+        Screen *screen = ScreenOfDisplay(disp, i);
+        parts[i] = (struct ConcatPart){
+            .drawable = RootWindowOfScreen(screen),
+            .w = WidthOfScreen(screen),
+            .h = HeightOfScreen(screen),
+        };
     }
-    free(subDisp);
 
-    return stalkImageConcat(images, imagesCount, HORIZONTAL);
+    return stalkImageConcat(parts, screens, HORIZONTAL);
 }
 
 static Imlib_Image scrotGrabShotMonitor(void)
 {
+    /* grab everything at once, scrotSaveMonitors() splits it afterwards */
+    if (opt.monitor == MONITOR_ALL)
+        return scrotGrabShot();
+
     int numMonitors;
     XRRMonitorInfo *monitors = XRRGetMonitors(disp, root, True, &numMonitors);
     if (!monitors)
@@ -960,67 +1664,75 @@ static Imlib_Image scrotGrabShotMonitor(void)
 
     XRRMonitorInfo *m = monitors + opt.monitor;
     int x = m->x, y = m->y, h = m->height, w = m->width;
+    if (!shotMonitor.name && m->name)
+        shotMonitor.name = XGetAtomName(disp, m->name);
+    shotMonitor.index = opt.monitor;
     XRRFreeMonitors(monitors);
 
     scrotNiceClip(&x, &y, &w, &h);
     return scrotGrabRectAndPointer(x, y, w, h);
 }
 
+static void fillBlack(uint32_t *data, int stride, int x, int y, int w, int h)
+{
+    for (int row = y; row < y + h; ++row) {
+        for (int col = x; col < x + w; ++col)
+            data[row * stride + col] = 0xff000000;
+    }
+}
+
+/* Grab each part straight into its slot of the final image, laid out in a
+ * row or a column. The slots are sized upfront, so that the parts don't have
+ * to be held in memory besides the final image. Frees `parts`.
+ */
 static Imlib_Image stalkImageConcat(
-    Imlib_Image *images, size_t imagesCount, const enum Direction dir)
+    struct ConcatPart *parts, size_t partsCount, const enum Direction dir)
 {
-    if (imagesCount == 0)
+    if (partsCount == 0) {
+        free(parts);
         return NULL;
-
-    int total = 0, max = 0;
-    int x = 0, y = 0, w , h;
-    Imlib_Image ret, im;
+    }
 
     const bool vertical = (dir == VERTICAL) ? true : false;
+    int total = 0, max = 0;
 
-    for (size_t i = 0; i < imagesCount; ++i) {
-        im = images[i];
-        imlib_context_set_image(im);
-        h = imlib_image_get_height();
-        w = imlib_image_get_width();
+    for (size_t i = 0; i < partsCount; ++i) {
         if (!vertical) {
-            if (h > max)
-                max = h;
-            total += w;
+            max = MAX(max, parts[i].h);
+            total += parts[i].w;
         } else {
-            if (w > max)
-                max = w;
-            total += h;
+            max = MAX(max, parts[i].w);
+            total += parts[i].h;
         }
     }
-    if (!vertical) {
-        w = total;
-        h = max;
-    } else {
-        w = max;
-        h = total;
-    }
-    ret = imlib_create_image(w, h);
+    const int width = vertical ? max : total;
+    const int height = vertical ? total : max;
+    Imlib_Image ret = imlib_create_image(width, height);
+    if (!ret)
+        errx(EXIT_FAILURE, "failed to create a %dx%d image", width, height);
 
     imlib_context_set_image(ret);
-    imlib_context_set_color(0, 0, 0, 255);
-    imlib_image_fill_rectangle(0, 0, w, h);
-
-    imlib_context_set_anti_alias(0);
-    imlib_context_set_dither(1);
-    imlib_context_set_blend(0);
-
-    for (size_t i = 0; i < imagesCount; ++i) {
-        im = images[i];
-        imlib_context_set_image(im);
-        h = imlib_image_get_height();
-        w = imlib_image_get_width();
-        imlib_context_set_image(ret);
-        imlib_blend_image_onto_image(im, 0, 0, 0, w, h, x, y, w, h);
-        (!vertical) ? (x += w) : (y += h);
-        imlib_context_set_image(im);
-        imlib_free_image_and_decache();
+    uint32_t *data = imlib_image_get_data();
+
+    int x = 0, y = 0;
+    for (size_t i = 0; i < partsCount; ++i) {
+        struct ConcatPart *part = parts + i;
+        part->dst = data + (size_t)y * width + x;
+        part->stride = width;
+        /* only the space next to parts smaller than the others is filled */
+        if (!vertical) {
+            fillBlack(data, width, x, part->h, part->w, height - part->h);
+            x += part->w;
+        } else {
+            fillBlack(data, width, part->w, y, width - part->w, part->h);
+            y += part->h;
+        }
     }
-    free(images);
+    scrotGrabParts(parts, partsCount);
+
+    imlib_context_set_image(ret);
+    imlib_image_put_back_data(data);
+    imlib_image_set_has_alpha(0);
+    free(parts);
     return ret;
 }
@@ -46,7 +46,9 @@ void scrotNiceClip(int *, int *, int *, int *);
 struct timespec clockNow(void);
 struct timespec scrotSleepFor(struct timespec, int);
 void scrotDoDelay(void);
+Imlib_Image scrotGrabRect(int, int, int, int);
 Imlib_Image scrotGrabRectAndPointer(int, int, int, int);
+Imlib_Image scrotGrabWindowComposite(Window);
 void scrotGrabMousePointer(Imlib_Image, const int, const int);
 size_t scrotHaveFileExtension(const char *, char **);
 
@@ -0,0 +1,582 @@
+/* scrot_convert.c
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/*
+    This file is part of the scrot project.
+
+    Converts the pixels of an XImage to the ARGB32 layout used by Imlib2.
+    Imlib2 handles any visual, but one pixel at a time. The handful of
+    TrueColor formats found in practice are handled here with SSE2 and AVX2
+    kernels, picked at runtime. Anything else is left to Imlib2.
+
+    The cursor is blended over the shots here as well, straight from the
+    premultiplied pixels XFixes returns, and thumbnails are scaled here when
+    they are saved off the main thread.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Imlib2.h>
+#include <X11/Xlib.h>
+
+#include "scrot_convert.h"
+#include "util.h"
+
+#if HAVE_X86_SIMD
+    #include <immintrin.h>
+#endif
+
+enum PixelLayout {
+    LAYOUT_XRGB32, /* 0xXXRRGGBB in host byte order */
+    LAYOUT_XBGR32, /* 0xXXBBGGRR in host byte order */
+    LAYOUT_BGR24, /* packed B, G, R bytes */
+    LAYOUT_16, /* 16 bits in host byte order, any masks */
+};
+
+struct PixelFormat {
+    enum PixelLayout layout;
+    /* LAYOUT_16 only: position and width of each of red, green and blue */
+    int shift[3];
+    int bits[3];
+    unsigned long mask[3];
+};
+
+typedef void ConvertRowFunc(uint32_t *, const unsigned char *, int,
+    const struct PixelFormat *);
+
+static const uint32_t alphaBits = 0xff000000;
+
+static bool maskShape(unsigned long mask, int *shift, int *bits)
+{
+    if (!mask)
+        return false;
+    for (*shift = 0; !(mask & 1); mask >>= 1)
+        ++*shift;
+    for (*bits = 0; mask & 1; mask >>= 1)
+        ++*bits;
+    return mask == 0;
+}
+
+static bool pixelFormat(const XImage *ximage, struct PixelFormat *fmt)
+{
+    const union { uint16_t u16; unsigned char byte; } probe = { 1 };
+    const int hostOrder = probe.byte ? LSBFirst : MSBFirst;
+    const unsigned long r = ximage->red_mask;
+    const unsigned long g = ximage->green_mask;
+    const unsigned long b = ximage->blue_mask;
+
+    if (ximage->format != ZPixmap)
+        return false;
+
+    switch (ximage->bits_per_pixel) {
+    case 32:
+        if (ximage->byte_order != hostOrder || g != 0xff00)
+            return false;
+        if (r == 0xff0000 && b == 0xff)
+            fmt->layout = LAYOUT_XRGB32;
+        else if (r == 0xff && b == 0xff0000)
+            fmt->layout = LAYOUT_XBGR32;
+        else
+            return false;
+        return true;
+    case 24:
+        fmt->layout = LAYOUT_BGR24;
+        return ximage->byte_order == LSBFirst
+            && r == 0xff0000 && g == 0xff00 && b == 0xff;
+    case 16:
+        if (ximage->byte_order != hostOrder)
+            return false;
+        fmt->layout = LAYOUT_16;
+        fmt->mask[0] = r;
+        fmt->mask[1] = g;
+        fmt->mask[2] = b;
+        for (int c = 0; c < 3; ++c) {
+            /* channels narrower than 4 bits can't be expanded to 8 bits by
+             * repeating their top bits only once */
+            if (!maskShape(fmt->mask[c], &fmt->shift[c], &fmt->bits[c])
+                || fmt->bits[c] < 4 || fmt->bits[c] > 8)
+                return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+static uint32_t expand16(uint32_t p, const struct PixelFormat *fmt)
+{
+    uint32_t argb = alphaBits;
+    for (int c = 0; c < 3; ++c) {
+        const uint32_t v = (p & fmt->mask[c]) >> fmt->shift[c];
+        const uint32_t v8 = (v << (8 - fmt->bits[c]))
+            | (v >> (2 * fmt->bits[c] - 8));
+        argb |= v8 << (16 - 8 * c);
+    }
+    return argb;
+}
+
+/* The scalar kernels also finish the rows left over by the SIMD ones. */
+
+static void convertXrgb32(uint32_t *dst, const unsigned char *src, int w,
+    const struct PixelFormat *fmt)
+{
+    (void)fmt;
+    for (int i = 0; i < w; ++i) {
+        uint32_t p;
+        memcpy(&p, src + 4 * i, sizeof(p));
+        dst[i] = p | alphaBits;
+    }
+}
+
+static void convertXbgr32(uint32_t *dst, const unsigned char *src, int w,
+    const struct PixelFormat *fmt)
+{
+    (void)fmt;
+    for (int i = 0; i < w; ++i) {
+        uint32_t p;
+        memcpy(&p, src + 4 * i, sizeof(p));
+        dst[i] = alphaBits | (p & 0xff) << 16 | (p & 0xff00)
+            | (p >> 16 & 0xff);
+    }
+}
+
+static void convertBgr24(uint32_t *dst, const unsigned char *src, int w,
+    const struct PixelFormat *fmt)
+{
+    (void)fmt;
+    for (int i = 0; i < w; ++i) {
+        const unsigned char *p = src + 3 * i;
+        dst[i] = alphaBits | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0];
+    }
+}
+
+static void convert16(uint32_t *dst, const unsigned char *src, int w,
+    const struct PixelFormat *fmt)
+{
+    for (int i = 0; i < w; ++i) {
+        uint16_t p;
+        memcpy(&p, src + 2 * i, sizeof(p));
+        dst[i] = expand16(p, fmt);
+    }
+}
+
+#if HAVE_X86_SIMD
+
+SSE2 static void convertXrgb32Sse2(uint32_t *dst, const unsigned char *src,
+    int w, const struct PixelFormat *fmt)
+{
+    const __m128i alpha = _mm_set1_epi32((int)alphaBits);
+    int i = 0;
+    for (; i + 4 <= w; i += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(p, alpha));
+    }
+    convertXrgb32(dst + i, src + 4 * i, w - i, fmt);
+}
+
+SSE2 static void convertXbgr32Sse2(uint32_t *dst, const unsigned char *src,
+    int w, const struct PixelFormat *fmt)
+{
+    const __m128i alpha = _mm_set1_epi32((int)alphaBits);
+    const __m128i rbMask = _mm_set1_epi32(0x00ff00ff);
+    const __m128i gMask = _mm_set1_epi32(0x0000ff00);
+    int i = 0;
+    for (; i + 4 <= w; i += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+        __m128i rb = _mm_and_si128(p, rbMask);
+        __m128i out = _mm_or_si128(_mm_slli_epi32(rb, 16),
+            _mm_srli_epi32(rb, 16));
+        out = _mm_or_si128(out, _mm_and_si128(p, gMask));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(out, alpha));
+    }
+    convertXbgr32(dst + i, src + 4 * i, w - i, fmt);
+}
+
+SSE2 static inline __m128i expand16Sse2(__m128i p,
+    const struct PixelFormat *fmt)
+{
+    __m128i out = _mm_set1_epi32((int)alphaBits);
+    for (int c = 0; c < 3; ++c) {
+        __m128i v = _mm_and_si128(p, _mm_set1_epi32((int)fmt->mask[c]));
+        v = _mm_srl_epi32(v, _mm_cvtsi32_si128(fmt->shift[c]));
+        v = _mm_or_si128(_mm_sll_epi32(v, _mm_cvtsi32_si128(8 - fmt->bits[c])),
+            _mm_srl_epi32(v, _mm_cvtsi32_si128(2 * fmt->bits[c] - 8)));
+        out = _mm_or_si128(out,
+            _mm_sll_epi32(v, _mm_cvtsi32_si128(16 - 8 * c)));
+    }
+    return out;
+}
+
+SSE2 static void convert16Sse2(uint32_t *dst, const unsigned char *src, int w,
+    const struct PixelFormat *fmt)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 8 <= w; i += 8) {
+        __m128i p = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+        _mm_storeu_si128((__m128i *)(dst + i),
+            expand16Sse2(_mm_unpacklo_epi16(p, zero), fmt));
+        _mm_storeu_si128((__m128i *)(dst + i + 4),
+            expand16Sse2(_mm_unpackhi_epi16(p, zero), fmt));
+    }
+    convert16(dst + i, src + 2 * i, w - i, fmt);
+}
+
+AVX2 static void convertXrgb32Avx2(uint32_t *dst, const unsigned char *src,
+    int w, const struct PixelFormat *fmt)
+{
+    const __m256i alpha = _mm256_set1_epi32((int)alphaBits);
+    int i = 0;
+    for (; i + 8 <= w; i += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(src + 4 * i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(p, alpha));
+    }
+    convertXrgb32(dst + i, src + 4 * i, w - i, fmt);
+}
+
+AVX2 static void convertXbgr32Avx2(uint32_t *dst, const unsigned char *src,
+    int w, const struct PixelFormat *fmt)
+{
+    const __m256i shuffle = _mm256_setr_epi8(
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    const __m256i alpha = _mm256_set1_epi32((int)alphaBits);
+    int i = 0;
+    for (; i + 8 <= w; i += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(src + 4 * i));
+        p = _mm256_shuffle_epi8(p, shuffle);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(p, alpha));
+    }
+    convertXbgr32(dst + i, src + 4 * i, w - i, fmt);
+}
+
+AVX2 static void convertBgr24Avx2(uint32_t *dst, const unsigned char *src,
+    int w, const struct PixelFormat *fmt)
+{
+    const __m256i shuffle = _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32((int)alphaBits);
+    int i = 0;
+    /* Each half loads 16 bytes for 4 pixels (12 bytes), stop early enough
+     * for the last load to stay within the row. */
+    for (; i + 10 <= w; i += 8) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src + 3 * i));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src + 3 * i + 12));
+        __m256i p = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        p = _mm256_shuffle_epi8(p, shuffle);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(p, alpha));
+    }
+    convertBgr24(dst + i, src + 3 * i, w - i, fmt);
+}
+
+AVX2 static void convert16Avx2(uint32_t *dst, const unsigned char *src, int w,
+    const struct PixelFormat *fmt)
+{
+    int i = 0;
+    for (; i + 8 <= w; i += 8) {
+        __m256i p = _mm256_cvtepu16_epi32(
+            _mm_loadu_si128((const __m128i *)(src + 2 * i)));
+        __m256i out = _mm256_set1_epi32((int)alphaBits);
+        for (int c = 0; c < 3; ++c) {
+            __m256i v = _mm256_and_si256(p,
+                _mm256_set1_epi32((int)fmt->mask[c]));
+            v = _mm256_srl_epi32(v, _mm_cvtsi32_si128(fmt->shift[c]));
+            v = _mm256_or_si256(
+                _mm256_sll_epi32(v, _mm_cvtsi32_si128(8 - fmt->bits[c])),
+                _mm256_srl_epi32(v, _mm_cvtsi32_si128(2 * fmt->bits[c] - 8)));
+            out = _mm256_or_si256(out,
+                _mm256_sll_epi32(v, _mm_cvtsi32_si128(16 - 8 * c)));
+        }
+        _mm256_storeu_si256((__m256i *)(dst + i), out);
+    }
+    convert16(dst + i, src + 2 * i, w - i, fmt);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+static ConvertRowFunc *pickKernel(enum PixelLayout layout)
+{
+    static ConvertRowFunc *const scalar[] = {
+        [LAYOUT_XRGB32] = convertXrgb32,
+        [LAYOUT_XBGR32] = convertXbgr32,
+        [LAYOUT_BGR24] = convertBgr24,
+        [LAYOUT_16] = convert16,
+    };
+#if HAVE_X86_SIMD
+    static ConvertRowFunc *const sse2[] = {
+        [LAYOUT_XRGB32] = convertXrgb32Sse2,
+        [LAYOUT_XBGR32] = convertXbgr32Sse2,
+        [LAYOUT_BGR24] = convertBgr24,
+        [LAYOUT_16] = convert16Sse2,
+    };
+    static ConvertRowFunc *const avx2[] = {
+        [LAYOUT_XRGB32] = convertXrgb32Avx2,
+        [LAYOUT_XBGR32] = convertXbgr32Avx2,
+        [LAYOUT_BGR24] = convertBgr24Avx2,
+        [LAYOUT_16] = convert16Avx2,
+    };
+
+    switch (cpuLevel()) {
+    case CPU_AVX2:
+        return avx2[layout];
+    case CPU_SSE2:
+        return sse2[layout];
+    case CPU_SCALAR:
+        break;
+    }
+#endif
+    return scalar[layout];
+}
+
+/* Convert `ximage` into the ARGB32 buffer `dst`, whose rows are `dstStride`
+ * pixels apart. Returns false if the format of `ximage` isn't handled.
+ */
+bool scrotConvertXImageTo(const XImage *ximage, uint32_t *dst,
+    size_t dstStride)
+{
+    struct PixelFormat fmt;
+    if (!pixelFormat(ximage, &fmt))
+        return false;
+
+    ConvertRowFunc *convertRow = pickKernel(fmt.layout);
+    const unsigned char *src = (const unsigned char *)ximage->data;
+    for (int y = 0; y < ximage->height; ++y) {
+        convertRow(dst, src, ximage->width, &fmt);
+        dst += dstStride;
+        src += ximage->bytes_per_line;
+    }
+    return true;
+}
+
+/* Create an opaque Imlib2 image from `ximage`. Returns NULL if the format of
+ * `ximage` isn't handled, imlib_create_image_from_ximage() should be used
+ * instead then. The current Imlib2 context image is left untouched.
+ */
+Imlib_Image scrotConvertXImage(const XImage *ximage)
+{
+    struct PixelFormat fmt;
+    if (!pixelFormat(ximage, &fmt))
+        return NULL;
+
+    Imlib_Image im = imlib_create_image(ximage->width, ximage->height);
+    if (!im)
+        return NULL;
+
+    Imlib_Image prev = imlib_context_get_image();
+    imlib_context_set_image(im);
+    uint32_t *data = imlib_image_get_data();
+    scrotConvertXImageTo(ximage, data, ximage->width);
+    imlib_image_put_back_data(data);
+    imlib_image_set_has_alpha(0);
+    imlib_context_set_image(prev);
+    return im;
+}
+
+/* Cursor blending: dst = src + dst * (255 - src.alpha) / 255 for each channel,
+ * `src` being premultiplied. */
+
+typedef void BlendRowFunc(uint32_t *, const unsigned long *, int);
+
+static uint32_t div255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static void blendRow(uint32_t *dst, const unsigned long *src, int w)
+{
+    for (int i = 0; i < w; ++i) {
+        const uint32_t s = src[i] & 0xffffffff;
+        const uint32_t inv = 255 - (s >> 24);
+        uint32_t out = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            const uint32_t c = (s >> shift & 0xff)
+                + div255((dst[i] >> shift & 0xff) * inv);
+            out |= MIN(c, 255u) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+#if HAVE_X86_SIMD
+
+/* XFixes hands out pixels as unsigned long, narrow 4 of them to 32 bits */
+SSE2 static inline __m128i loadCursor4(const unsigned long *src)
+{
+    if (sizeof(*src) == 4)
+        return _mm_loadu_si128((const __m128i *)src);
+    __m128i a = _mm_loadu_si128((const __m128i *)src);
+    __m128i b = _mm_loadu_si128((const __m128i *)src + 1);
+    a = _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0));
+    b = _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0));
+    return _mm_unpacklo_epi64(a, b);
+}
+
+/* blend 2 pixels widened to 16 bits per channel */
+SSE2 static inline __m128i blend16Sse2(__m128i s, __m128i d)
+{
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+    __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(d, inv), _mm_set1_epi16(128));
+    t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    return _mm_add_epi16(s, t);
+}
+
+SSE2 static void blendRowSse2(uint32_t *dst, const unsigned long *src, int w)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= w; i += 4) {
+        __m128i s = loadCursor4(src + i);
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i lo = blend16Sse2(_mm_unpacklo_epi8(s, zero),
+            _mm_unpacklo_epi8(d, zero));
+        __m128i hi = blend16Sse2(_mm_unpackhi_epi8(s, zero),
+            _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    blendRow(dst + i, src + i, w - i);
+}
+
+AVX2 static void blendRowAvx2(uint32_t *dst, const unsigned long *src, int w)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaShuffle = _mm256_setr_epi8(
+        6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+        6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+    int i = 0;
+    for (; i + 8 <= w; i += 8) {
+        __m256i s;
+        if (sizeof(*src) == 4) {
+            s = _mm256_loadu_si256((const __m256i *)(src + i));
+        } else {
+            /* keep the low half of each 64-bit value */
+            const __m256i narrow = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+            __m256i a = _mm256_loadu_si256((const __m256i *)(src + i));
+            __m256i b = _mm256_loadu_si256((const __m256i *)(src + i + 4));
+            a = _mm256_permutevar8x32_epi32(a, narrow);
+            b = _mm256_permutevar8x32_epi32(b, narrow);
+            s = _mm256_permute2x128_si256(a, b, 0x20);
+        }
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i out[2];
+        for (int half = 0; half < 2; ++half) {
+            __m256i s16 = half ? _mm256_unpackhi_epi8(s, zero)
+                : _mm256_unpacklo_epi8(s, zero);
+            __m256i d16 = half ? _mm256_unpackhi_epi8(d, zero)
+                : _mm256_unpacklo_epi8(d, zero);
+            __m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(255),
+                _mm256_shuffle_epi8(s16, alphaShuffle));
+            __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(d16, inv),
+                _mm256_set1_epi16(128));
+            t = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)),
+                8);
+            out[half] = _mm256_add_epi16(s16, t);
+        }
+        /* unpack and pack work within lanes, so the order is preserved */
+        _mm256_storeu_si256((__m256i *)(dst + i),
+            _mm256_packus_epi16(out[0], out[1]));
+    }
+    blendRow(dst + i, src + i, w - i);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+/* Blend the premultiplied `cursor`, whose top left corner is at (x, y), over
+ * the ARGB32 buffer `dst`. The cursor is clipped to the buffer.
+ */
+void scrotBlendCursor(uint32_t *dst, int dstW, int dstH,
+    const XFixesCursorImage *cursor, int x, int y)
+{
+    const int x0 = MAX(x, 0), y0 = MAX(y, 0);
+    const int x1 = MIN(x + cursor->width, dstW);
+    const int y1 = MIN(y + cursor->height, dstH);
+    if (x1 <= x0 || y1 <= y0)
+        return;
+
+    BlendRowFunc *blend = blendRow;
+#if HAVE_X86_SIMD
+    switch (cpuLevel()) {
+    case CPU_AVX2:
+        blend = blendRowAvx2;
+        break;
+    case CPU_SSE2:
+        blend = blendRowSse2;
+        break;
+    case CPU_SCALAR:
+        break;
+    }
+#endif
+
+    for (int row = y0; row < y1; ++row) {
+        const unsigned long *src = cursor->pixels
+            + (size_t)(row - y) * cursor->width + (x0 - x);
+        blend(dst + (size_t)row * dstW + x0, src, x1 - x0);
+    }
+}
+
+/* Scale the w * h ARGB32 pixels at `src` to dw * dh pixels at `dst` with a
+ * box filter: each pixel is the mean of the pixels of `src` it covers. When
+ * enlarging, pixels are repeated instead.
+ */
+void scrotScaleImage(const uint32_t *src, int w, int h, uint32_t *dst, int dw,
+    int dh)
+{
+    int *xs = ecalloc(dw + 1, sizeof(*xs));
+    uint64_t (*sum)[4] = ecalloc(dw, sizeof(*sum));
+
+    for (int x = 0; x < dw; ++x)
+        xs[x] = 1LL * x * w / dw;
+    xs[dw] = w;
+    for (int y = 0; y < dh; ++y) {
+        const int y0 = 1LL * y * h / dh;
+        const int y1 = MAX(1LL * (y + 1) * h / dh, y0 + 1);
+        memset(sum, 0, dw * sizeof(*sum));
+        for (int sy = y0; sy < y1; ++sy) {
+            const uint32_t *row = src + (size_t)sy * w;
+            for (int x = 0; x < dw; ++x) {
+                const int x1 = MAX(xs[x + 1], xs[x] + 1);
+                for (int sx = xs[x]; sx < x1; ++sx) {
+                    for (int c = 0; c < 4; ++c)
+                        sum[x][c] += (row[sx] >> (8 * c)) & 0xff;
+                }
+            }
+        }
+        for (int x = 0; x < dw; ++x) {
+            const uint64_t n = 1ULL * (y1 - y0)
+                * (MAX(xs[x + 1], xs[x] + 1) - xs[x]);
+            uint32_t p = 0;
+            for (int c = 0; c < 4; ++c)
+                p |= ((sum[x][c] + n / 2) / n) << (8 * c);
+            dst[(size_t)y * dw + x] = p;
+        }
+    }
+    free(sum);
+    free(xs);
+}
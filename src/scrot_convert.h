@@ -0,0 +1,43 @@
+/* scrot_convert.h
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef H_SCROT_CONVERT
+#define H_SCROT_CONVERT
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Imlib2.h>
+#include <X11/Xlib.h>
+#include <X11/extensions/Xfixes.h>
+
+bool scrotConvertXImageTo(const XImage *, uint32_t *, size_t);
+Imlib_Image scrotConvertXImage(const XImage *);
+void scrotBlendCursor(uint32_t *, int, int, const XFixesCursorImage *, int,
+    int);
+void scrotScaleImage(const uint32_t *, int, int, uint32_t *, int, int);
+
+#endif /* !defined(H_SCROT_CONVERT) */
@@ -0,0 +1,366 @@
+/* scrot_daemon.c
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/*
+    This file is part of the scrot project.
+
+    --daemon listens on a Unix socket and keeps a small pool of pre-forked
+    workers around. Each worker opens the display ahead of time, waits for a
+    single request, takes the shot and exits, after which a fresh worker is
+    forked. Since every request runs in its own process, a failing shot can
+    exit() as usual without taking the daemon down with it.
+
+    A request is sent by --client as a 32-bit payload size along with the
+    client's stdout and stderr (SCM_RIGHTS), followed by the payload: the
+    client's working directory, its $DISPLAY (empty if unset) and its
+    arguments, each NUL terminated. The
+    worker answers with a single 0 byte once the shot was saved, a client that
+    sees the connection close without it reports a failure.
+
+    Both ends check that the other one runs as the same user. Without
+    $XDG_RUNTIME_DIR, the socket goes in a directory of /tmp that only the
+    user may access.
+*/
+
+#if defined(__linux__)
+    /* struct ucred */
+    #define _GNU_SOURCE
+#endif
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <err.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "options.h"
+#include "scrot_daemon.h"
+#include "util.h"
+
+enum {
+    DAEMON_WORKERS = 2,
+    DAEMON_MAX_REQUEST = 1 << 20,
+};
+
+#if !defined(__linux__)
+/* BSD and macOS have it, but _XOPEN_SOURCE hides it */
+int getpeereid(int, uid_t *, gid_t *);
+#endif
+
+static struct sockaddr_un daemonAddr;
+static int listenFd = -1;
+static int connFd = -1;
+
+/* Whether the other end of the socket runs as the same user as scrot. */
+static bool daemonPeerIsUs(int fd)
+{
+    uid_t uid;
+#if defined(__linux__)
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+        return false;
+    uid = cred.uid;
+#else
+    gid_t gid;
+    if (getpeereid(fd, &uid, &gid) < 0)
+        return false;
+#endif
+    return uid == geteuid();
+}
+
+/* The fallback /tmp directory for the socket. Anyone may have created it
+ * first, so it has to be ours and closed to others. */
+static void daemonPrivateDir(const char *dir, bool create)
+{
+    struct stat st;
+    if (create && mkdir(dir, 0700) < 0 && errno != EEXIST)
+        err(EXIT_FAILURE, "couldn't create %s", dir);
+    if (lstat(dir, &st) < 0) {
+        if (errno == ENOENT && !create)
+            return; /* no daemon ever ran, connect() will fail */
+        err(EXIT_FAILURE, "%s", dir);
+    }
+    if (!S_ISDIR(st.st_mode) || st.st_uid != geteuid()
+        || (st.st_mode & 0077) != 0) {
+        errx(EXIT_FAILURE, "%s must be a directory only accessible by its "
+            "owner, you", dir);
+    }
+}
+
+static void daemonSocketAddress(bool create)
+{
+    const char *path = opt.socketPath;
+    char buf[sizeof(daemonAddr.sun_path)];
+
+    if (!path) {
+        const char *dir = getenv("XDG_RUNTIME_DIR");
+        if (dir && *dir) {
+            snprintf(buf, sizeof(buf), "%s/scrot.sock", dir);
+        } else {
+            snprintf(buf, sizeof(buf), "/tmp/scrot-%ju",
+                (uintmax_t)geteuid());
+            daemonPrivateDir(buf, create);
+            strncat(buf, "/scrot.sock", sizeof(buf) - strlen(buf) - 1);
+        }
+        path = buf;
+    }
+    if (strlen(path) >= sizeof(daemonAddr.sun_path))
+        errx(EXIT_FAILURE, "socket path is too long: %s", path);
+
+    daemonAddr.sun_family = AF_UNIX;
+    strcpy(daemonAddr.sun_path, path);
+}
+
+static int daemonConnect(void)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        err(EXIT_FAILURE, "socket");
+    if (connect(fd, (struct sockaddr *)&daemonAddr, sizeof(daemonAddr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool readAll(int fd, void *buf, size_t n)
+{
+    char *p = buf;
+    while (n > 0) {
+        ssize_t ret = read(fd, p, n);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        p += ret;
+        n -= ret;
+    }
+    return true;
+}
+
+static void daemonCleanup(int sig)
+{
+    unlink(daemonAddr.sun_path);
+    _exit(128 + sig);
+}
+
+/* Forks the worker pool and only returns in a worker, which should then
+ * prepare everything it can before calling scrotDaemonReceive().
+ */
+void scrotDaemonRun(void)
+{
+    daemonSocketAddress(true);
+
+    int fd = daemonConnect();
+    if (fd >= 0)
+        errx(EXIT_FAILURE, "a daemon is already listening on %s",
+            daemonAddr.sun_path);
+    unlink(daemonAddr.sun_path); /* stale socket from a daemon that died */
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+        err(EXIT_FAILURE, "socket");
+    mode_t oldMask = umask(0077);
+    if (bind(listenFd, (struct sockaddr *)&daemonAddr, sizeof(daemonAddr)) < 0)
+        err(EXIT_FAILURE, "couldn't bind to %s", daemonAddr.sun_path);
+    umask(oldMask);
+    if (listen(listenFd, SOMAXCONN) < 0)
+        err(EXIT_FAILURE, "listen");
+
+    signal(SIGINT, daemonCleanup);
+    signal(SIGTERM, daemonCleanup);
+    signal(SIGHUP, daemonCleanup);
+
+    for (int workers = 0;;) {
+        for (; workers < DAEMON_WORKERS; ++workers) {
+            pid_t pid = fork();
+            if (pid < 0)
+                err(EXIT_FAILURE, "fork");
+            if (pid == 0) {
+                signal(SIGINT, SIG_DFL);
+                signal(SIGTERM, SIG_DFL);
+                signal(SIGHUP, SIG_DFL);
+                return;
+            }
+        }
+        if (wait(NULL) > 0)
+            --workers;
+        else if (errno != EINTR)
+            err(EXIT_FAILURE, "wait");
+    }
+}
+
+/* Wait for a request, redirect stdout and stderr to the client's and load the
+ * client's options.
+ */
+void scrotDaemonReceive(void)
+{
+    do {
+        connFd = accept(listenFd, NULL, NULL);
+    } while (connFd < 0 && errno == EINTR);
+    if (connFd < 0)
+        err(EXIT_FAILURE, "accept");
+    close(listenFd);
+    if (!daemonPeerIsUs(connFd))
+        errx(EXIT_FAILURE, "refused a request from another user");
+
+    uint32_t size;
+    int fds[2];
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(fds))];
+    } control;
+    struct iovec iov = { .iov_base = &size, .iov_len = sizeof(size) };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+    if (recvmsg(connFd, &msg, 0) != sizeof(size))
+        errx(EXIT_FAILURE, "malformed request");
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS
+        || cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+        errx(EXIT_FAILURE, "malformed request");
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    dup2(fds[0], STDOUT_FILENO);
+    dup2(fds[1], STDERR_FILENO);
+    close(fds[0]);
+    close(fds[1]);
+
+    if (size == 0 || size > DAEMON_MAX_REQUEST)
+        errx(EXIT_FAILURE, "malformed request");
+    char *payload = ecalloc(size, sizeof(*payload));
+    if (!readAll(connFd, payload, size) || payload[size - 1] != '\0')
+        errx(EXIT_FAILURE, "malformed request");
+
+    const char *cwd = payload;
+    char *display = payload + strlen(cwd) + 1;
+    if (display >= payload + size)
+        errx(EXIT_FAILURE, "malformed request");
+    int argc = 1;
+    char **argv = ecalloc(size + 2, sizeof(*argv));
+    argv[0] = "scrot";
+    for (char *p = display + strlen(display) + 1; p < payload + size;
+        p += strlen(p) + 1) {
+        argv[argc++] = p;
+    }
+
+    if (chdir(cwd) < 0)
+        err(EXIT_FAILURE, "couldn't change directory to %s", cwd);
+
+    optind = 0; /* reinitialize getopt_long() */
+    optionsParse(argc, argv);
+    /* the client's display, unless it asked for another one with -D */
+    if (!opt.display && *display)
+        opt.display = display;
+    /* the payload is kept around since opt points into it */
+}
+
+/* Tell the client that the shot was taken successfully. */
+void scrotDaemonReply(void)
+{
+    if (connFd < 0)
+        return;
+    fflush(stdout);
+    writeAll(connFd, &(char){ EXIT_SUCCESS }, 1);
+}
+
+/* Forward the command line to the daemon and wait for it to take the shot.
+ * Returns the exit status for the client, or -1 if no daemon is listening.
+ */
+int scrotDaemonClient(int argc, char *argv[])
+{
+    daemonSocketAddress(false);
+    int fd = daemonConnect();
+    if (fd < 0)
+        return -1;
+    if (!daemonPeerIsUs(fd))
+        errx(EXIT_FAILURE, "option --client: %s belongs to another user",
+            daemonAddr.sun_path);
+
+    Stream payload = {0};
+    char *cwd = NULL;
+    for (size_t n = 256;; n *= 2) {
+        cwd = erealloc(cwd, n);
+        if (getcwd(cwd, n))
+            break;
+        if (errno != ERANGE)
+            err(EXIT_FAILURE, "getcwd");
+    }
+    streamMem(&payload, cwd, strlen(cwd) + 1);
+    free(cwd);
+    const char *display = getenv("DISPLAY");
+    if (!display)
+        display = "";
+    streamMem(&payload, display, strlen(display) + 1);
+    for (int i = 1; i < argc; ++i)
+        streamMem(&payload, argv[i], strlen(argv[i]) + 1);
+    if (payload.off > DAEMON_MAX_REQUEST)
+        errx(EXIT_FAILURE, "option --client: command line is too long");
+
+    uint32_t size = payload.off;
+    int fds[2] = { STDOUT_FILENO, STDERR_FILENO };
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(fds))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = { .iov_base = &size, .iov_len = sizeof(size) };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    if (sendmsg(fd, &msg, 0) != sizeof(size)
+        || !writeAll(fd, payload.buf, payload.off))
+        err(EXIT_FAILURE, "couldn't send request to %s", daemonAddr.sun_path);
+    free(payload.buf);
+
+    char status;
+    bool ok = readAll(fd, &status, 1) && status == EXIT_SUCCESS;
+    close(fd);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,126 @@
+/* scrot_damage.c
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/*
+    This file is part of the scrot project.
+    Tracks changes to the root window with the XDamage extension so that
+    repeated shots are only taken when something on screen actually changed,
+    and only the parts that changed need to be grabbed again.
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xfixes.h>
+
+#include "scrot.h"
+#include "scrot_damage.h"
+#include "util.h"
+
+static Damage damage;
+/* damage collected by the last XDamageSubtract() */
+static XserverRegion damageRegion;
+/* all the damage collected since the last scrotDamageTake() */
+static XserverRegion pendingRegion;
+static int damageEventBase;
+
+bool scrotDamageInit(void)
+{
+    if (!XDamageQueryExtension(disp, &damageEventBase, &(int){0}))
+        return false;
+
+    damage = XDamageCreate(disp, root, XDamageReportNonEmpty);
+    damageRegion = XFixesCreateRegion(disp, NULL, 0);
+    pendingRegion = XFixesCreateRegion(disp, NULL, 0);
+    return true;
+}
+
+static void scrotDamageCollect(void)
+{
+    XDamageSubtract(disp, damage, None, damageRegion);
+    XFixesUnionRegion(disp, pendingRegion, pendingRegion, damageRegion);
+}
+
+/* Return the rectangles that were damaged since the last call and start
+ * accumulating from scratch. Called right before grabbing so that only changes
+ * made after the shot count towards the next one. The returned array should be
+ * freed with XFree(), it's NULL if nothing was damaged.
+ */
+XRectangle *scrotDamageTake(int *count)
+{
+    /* Nothing else reads the events when only polling, drop those queued so
+     * far or they pile up with every shot. They all predate the subtract, so
+     * none that scrotDamageWait() needs is lost. */
+    XEvent ev;
+    while (XCheckTypedEvent(disp, damageEventBase + XDamageNotify, &ev))
+        ;
+    scrotDamageCollect();
+    XRectangle *rects = XFixesFetchRegion(disp, pendingRegion, count);
+    XFixesSetRegion(disp, pendingRegion, NULL, 0);
+    return rects;
+}
+
+static bool rectIntersects(const XRectangle *a, const XRectangle *b)
+{
+    return a->x < b->x + b->width && b->x < a->x + a->width &&
+        a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+static Bool isDamageEvent(Display *dpy, XEvent *ev, XPointer arg)
+{
+    (void)dpy;
+    (void)arg;
+    return ev->type == damageEventBase + XDamageNotify;
+}
+
+/* Block until the part of the screen covered by `area` gets damaged. Once the
+ * first change comes in, wait `coalesceMs` more milliseconds so that a burst
+ * of updates (e.g a window being redrawn) results in a single shot.
+ */
+void scrotDamageWait(const XRectangle *area, int coalesceMs)
+{
+    for (;;) {
+        XEvent ev;
+        /* other events, e.g cursor changes, are left in the queue */
+        XIfEvent(disp, &ev, isDamageEvent, NULL);
+
+        scrotSleepFor(clockNow(), coalesceMs);
+        while (XCheckTypedEvent(disp, damageEventBase + XDamageNotify, &ev))
+            ;
+
+        scrotDamageCollect();
+        int nrects = 0;
+        XRectangle *rects = XFixesFetchRegion(disp, damageRegion, &nrects);
+        bool hit = false;
+        for (int i = 0; i < nrects && !hit; ++i)
+            hit = rectIntersects(&rects[i], area);
+        if (rects)
+            XFree(rects);
+        if (hit)
+            return;
+    }
+}
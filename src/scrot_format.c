@@ -0,0 +1,264 @@
+/* scrot_format.c
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/*
+    This file is part of the scrot project.
+    Output formats that scrot writes itself instead of going through Imlib2's
+    savers. Besides PNG and JPEG, these are simple formats meant for pipelines
+    that would decode the image right away: they cost little more than a copy.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "scrot_format.h"
+#include "scrot_jpeg.h"
+#include "scrot_png.h"
+#include "util.h"
+
+/* Buffered output, writes stop at the first error. */
+struct Out {
+    int fd;
+    bool ok;
+    size_t len;
+    unsigned char buf[64 * 1024];
+};
+
+static void outFlush(struct Out *out)
+{
+    out->ok = out->ok && writeAll(out->fd, out->buf, out->len);
+    out->len = 0;
+}
+
+static void outBytes(struct Out *out, const void *p, size_t n)
+{
+    if (out->len + n > sizeof(out->buf))
+        outFlush(out);
+    if (n > sizeof(out->buf)) {
+        out->ok = out->ok && writeAll(out->fd, p, n);
+        return;
+    }
+    memcpy(out->buf + out->len, p, n);
+    out->len += n;
+}
+
+static void outByte(struct Out *out, unsigned char c)
+{
+    if (out->len == sizeof(out->buf))
+        outFlush(out);
+    out->buf[out->len++] = c;
+}
+
+static void outBE32(struct Out *out, uint32_t v)
+{
+    const unsigned char b[4] = { v >> 24, v >> 16, v >> 8, v };
+    outBytes(out, b, sizeof(b));
+}
+
+/* Writes the pixels as 8 bit RGB, RGBA or BGRA. */
+static void outPixels(struct Out *out, const uint32_t *data, size_t n,
+    bool hasAlpha, bool withAlpha, bool isBGR)
+{
+    const uint32_t alpha = hasAlpha ? 0 : 0xff000000;
+    for (size_t i = 0; i < n; ++i) {
+        const uint32_t p = data[i] | alpha;
+        unsigned char b[4] = { p >> 16, p >> 8, p, p >> 24 };
+        if (isBGR) {
+            b[0] = p;
+            b[2] = p >> 16;
+        }
+        outBytes(out, b, withAlpha ? 4 : 3);
+    }
+}
+
+static bool writePpm(int fd, const uint32_t *data, int w, int h,
+    bool hasAlpha, int level, int quality)
+{
+    (void)level;
+    (void)quality;
+    struct Out out = { .fd = fd, .ok = true };
+    char head[64];
+    int len = snprintf(head, sizeof(head), "P6\n%d %d\n255\n", w, h);
+    outBytes(&out, head, len);
+    outPixels(&out, data, (size_t)w * h, hasAlpha, false, false);
+    outFlush(&out);
+    return out.ok;
+}
+
+static bool writePam(int fd, const uint32_t *data, int w, int h,
+    bool hasAlpha, int level, int quality)
+{
+    (void)level;
+    (void)quality;
+    struct Out out = { .fd = fd, .ok = true };
+    char head[128];
+    int len = snprintf(head, sizeof(head), "P7\nWIDTH %d\nHEIGHT %d\n"
+        "DEPTH %d\nMAXVAL 255\nTUPLTYPE %s\nENDHDR\n", w, h, hasAlpha ? 4 : 3,
+        hasAlpha ? "RGB_ALPHA" : "RGB");
+    outBytes(&out, head, len);
+    outPixels(&out, data, (size_t)w * h, hasAlpha, hasAlpha, false);
+    outFlush(&out);
+    return out.ok;
+}
+
+/* https://tools.suckless.org/farbfeld/ */
+static bool writeFarbfeld(int fd, const uint32_t *data, int w, int h,
+    bool hasAlpha, int level, int quality)
+{
+    (void)level;
+    (void)quality;
+    struct Out out = { .fd = fd, .ok = true };
+    const uint32_t alpha = hasAlpha ? 0 : 0xff000000;
+    outBytes(&out, "farbfeld", 8);
+    outBE32(&out, w);
+    outBE32(&out, h);
+    for (size_t i = 0, n = (size_t)w * h; i < n; ++i) {
+        const uint32_t p = data[i] | alpha;
+        /* 16 bit big endian channels, x * 257 maps [0, 255] to [0, 65535] */
+        const unsigned char px[8] = {
+            p >> 16, p >> 16, p >> 8, p >> 8, p, p, p >> 24, p >> 24
+        };
+        outBytes(&out, px, sizeof(px));
+    }
+    outFlush(&out);
+    return out.ok;
+}
+
+/* Headerless 8 bit B, G, R, A: the layout of an ARGB32 buffer on little
+ * endian machines. */
+static bool writeBgra(int fd, const uint32_t *data, int w, int h,
+    bool hasAlpha, int level, int quality)
+{
+    (void)level;
+    (void)quality;
+    const uint32_t one = 1;
+    unsigned char isLittleEndian;
+    memcpy(&isLittleEndian, &one, 1);
+    if (hasAlpha && isLittleEndian)
+        return writeAll(fd, data, (size_t)w * h * sizeof(*data));
+
+    struct Out out = { .fd = fd, .ok = true };
+    outPixels(&out, data, (size_t)w * h, hasAlpha, true, true);
+    outFlush(&out);
+    return out.ok;
+}
+
+/* https://qoiformat.org/qoi-specification.pdf */
+static bool writeQoi(int fd, const uint32_t *data, int w, int h,
+    bool hasAlpha, int level, int quality)
+{
+    enum {
+        QOI_OP_INDEX = 0x00, QOI_OP_DIFF = 0x40, QOI_OP_LUMA = 0x80,
+        QOI_OP_RUN = 0xc0, QOI_OP_RGB = 0xfe, QOI_OP_RGBA = 0xff,
+    };
+    (void)level;
+    (void)quality;
+    struct Out out = { .fd = fd, .ok = true };
+    const uint32_t alpha = hasAlpha ? 0 : 0xff000000;
+    uint32_t index[64] = { 0 };
+    uint32_t prev = 0xff000000;
+    int run = 0;
+
+    outBytes(&out, "qoif", 4);
+    outBE32(&out, w);
+    outBE32(&out, h);
+    outByte(&out, hasAlpha ? 4 : 3);
+    outByte(&out, 0); /* sRGB with linear alpha */
+
+    for (size_t i = 0, n = (size_t)w * h; i < n; ++i) {
+        const uint32_t p = data[i] | alpha;
+        if (p == prev) {
+            if (++run == 62) {
+                outByte(&out, QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            outByte(&out, QOI_OP_RUN | (run - 1));
+            run = 0;
+        }
+
+        const unsigned char r = p >> 16, g = p >> 8, b = p, a = p >> 24;
+        const unsigned char pr = prev >> 16, pg = prev >> 8, pb = prev;
+        const int hash = (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+        if (index[hash] == p) {
+            outByte(&out, QOI_OP_INDEX | hash);
+        } else if (a == (prev >> 24)) {
+            const signed char dr = r - pr, dg = g - pg, db = b - pb;
+            const signed char drg = dr - dg, dbg = db - dg;
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2
+                && db <= 1) {
+                outByte(&out, QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2
+                    | (db + 2));
+            } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7
+                && dbg >= -8 && dbg <= 7) {
+                outByte(&out, QOI_OP_LUMA | (dg + 32));
+                outByte(&out, (drg + 8) << 4 | (dbg + 8));
+            } else {
+                const unsigned char px[4] = { QOI_OP_RGB, r, g, b };
+                outBytes(&out, px, sizeof(px));
+            }
+        } else {
+            const unsigned char px[5] = { QOI_OP_RGBA, r, g, b, a };
+            outBytes(&out, px, sizeof(px));
+        }
+        index[hash] = p;
+        prev = p;
+    }
+    if (run > 0)
+        outByte(&out, QOI_OP_RUN | (run - 1));
+    outBytes(&out, (const unsigned char[8]){ 0, 0, 0, 0, 0, 0, 0, 1 }, 8);
+    outFlush(&out);
+    return out.ok;
+}
+
+static const struct {
+    const char *name;
+    ImageWriter *write;
+} writers[] = {
+    { "bgra",     writeBgra },
+    { "farbfeld", writeFarbfeld },
+    { "ff",       writeFarbfeld },
+    { "jpeg",     scrotJpegWrite },
+    { "jpg",      scrotJpegWrite },
+    { "pam",      writePam },
+    { "png",      scrotPngWrite },
+    { "ppm",      writePpm },
+    { "qoi",      writeQoi },
+};
+
+/* Returns the writer for format, or NULL if Imlib2 has to save it. */
+ImageWriter *scrotFormatWriter(const char *format)
+{
+    for (size_t i = 0; i < ARRAY_COUNT(writers); ++i) {
+        if (strcasecmp(format, writers[i].name) == 0)
+            return writers[i].write;
+    }
+    return NULL;
+}
@@ -0,0 +1,44 @@
+/* scrot_format.h
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/*
+    This file is part of the scrot project.
+*/
+
+#ifndef H_SCROT_FORMAT
+#define H_SCROT_FORMAT
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Writes the w * h ARGB32 pixels to the fd. The alpha channel is only used
+ * if the bool is set. The last two ints are the -Z compression level and the
+ * -q quality, formats ignore those they have no use for. Returns false on
+ * write errors, with errno set. */
+typedef bool ImageWriter(int, const uint32_t *, int, int, bool, int, int);
+
+ImageWriter *scrotFormatWriter(const char *);
+
+#endif /* !defined(H_SCROT_FORMAT) */
@@ -0,0 +1,151 @@
+/* scrot_jpeg.c
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+/*
+    This file is part of the scrot project.
+    Writes JPEG files with libjpeg, handing it 4:2:0 YCbCr made by scrot_yuv.c
+    instead of RGB rows, which saves libjpeg its own color conversion and
+    downsampling. The image is converted in strips of 16 rows, the height of
+    a row of MCUs, so that the planes stay in cache.
+*/
+
+#include <errno.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <jpeglib.h>
+
+#include "scrot_jpeg.h"
+#include "scrot_yuv.h"
+#include "util.h"
+
+enum { STRIP_ROWS = 2 * DCTSIZE };
+
+/* Repeats the last sample up to the width of the MCUs. */
+static void padRow(unsigned char *row, int len, size_t stride)
+{
+    memset(row + len, row[len - 1], stride - len);
+}
+
+/* The default error_exit exits, which the workers mustn't do, so this one
+ * jumps back to scrotJpegWrite(). */
+static void jpegErrorExit(j_common_ptr cinfo)
+{
+    jmp_buf *jump = cinfo->client_data;
+    longjmp(*jump, 1);
+}
+
+/* With the parameters set here, libjpeg can only fail for lack of memory,
+ * which is reported through errno. Alpha is dropped, as JPEG has none. */
+bool scrotJpegWrite(int fd, const uint32_t *data, int w, int h, bool hasAlpha,
+    int level, int quality)
+{
+    (void)hasAlpha;
+    (void)level;
+
+    /* raw data has to fill whole MCUs, 16x16 luma and 8x8 chroma samples */
+    const size_t yStride = (w + STRIP_ROWS - 1) / STRIP_ROWS * STRIP_ROWS;
+    const size_t cStride = yStride / 2;
+    const int cw = (w + 1) / 2;
+    unsigned char *strip = calloc(STRIP_ROWS, yStride + cStride);
+    if (!strip)
+        return false;
+
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    jmp_buf jump;
+    unsigned char *out = NULL;
+    unsigned long outSize = 0;
+    cinfo.err = jpeg_std_error(&jerr);
+    jerr.error_exit = jpegErrorExit;
+    cinfo.client_data = &jump; /* kept by jpeg_create_compress() */
+    if (setjmp(jump)) {
+        jpeg_destroy_compress(&cinfo);
+        free(strip);
+        free(out);
+        errno = ENOMEM;
+        return false;
+    }
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &out, &outSize);
+
+    cinfo.image_width = w;
+    cinfo.image_height = h;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_YCbCr;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    cinfo.raw_data_in = TRUE;
+    cinfo.comp_info[0].h_samp_factor = 2;
+    cinfo.comp_info[0].v_samp_factor = 2;
+    for (int i = 1; i < 3; ++i) {
+        cinfo.comp_info[i].h_samp_factor = 1;
+        cinfo.comp_info[i].v_samp_factor = 1;
+    }
+    jpeg_start_compress(&cinfo, TRUE);
+
+    const struct Yuv420 planes = {
+        .y = strip,
+        .u = strip + STRIP_ROWS * yStride,
+        .v = strip + STRIP_ROWS * yStride + STRIP_ROWS / 2 * cStride,
+        .yStride = yStride,
+        .cStride = cStride,
+    };
+    JSAMPROW yRows[STRIP_ROWS], uRows[STRIP_ROWS / 2], vRows[STRIP_ROWS / 2];
+    JSAMPARRAY rows[3] = { yRows, uRows, vRows };
+
+    for (int y = 0; y < h; y += STRIP_ROWS) {
+        const int n = MIN(STRIP_ROWS, h - y), cn = (n + 1) / 2;
+        scrotYuvFromArgb(data + (size_t)y * w, w, w, n, YUV_BT601, true,
+            &planes);
+        /* rows past the bottom of the image repeat the last one */
+        for (int i = 0; i < STRIP_ROWS; ++i) {
+            yRows[i] = planes.y + MIN(i, n - 1) * yStride;
+            if (i < n)
+                padRow(yRows[i], w, yStride);
+        }
+        for (int i = 0; i < STRIP_ROWS / 2; ++i) {
+            uRows[i] = planes.u + MIN(i, cn - 1) * cStride;
+            vRows[i] = planes.v + MIN(i, cn - 1) * cStride;
+            if (i < cn) {
+                padRow(uRows[i], cw, cStride);
+                padRow(vRows[i], cw, cStride);
+            }
+        }
+        jpeg_write_raw_data(&cinfo, rows, STRIP_ROWS);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    free(strip);
+
+    const bool ok = writeAll(fd, out, outSize);
+    free(out);
+    return ok;
+}
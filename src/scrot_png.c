@@ -0,0 +1,283 @@
+/* scrot_png.c
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/*
+    This file is part of the scrot project.
+    A PNG writer that compresses the image on several threads. The image is
+    cut into bands of rows, each band is filtered and deflated on its own and
+    the results are joined into a single zlib stream, the way pigz does it.
+*/
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ZLIB_CONST
+#include <zlib.h>
+
+#include "scrot_png.h"
+#include "util.h"
+
+/* The deflate window. Each band is primed with this much of the data before
+ * it, so that splitting costs next to nothing in compression ratio. */
+enum { DICT_SIZE = 32768 };
+/* uncompressed bytes per band, a band is the unit of work of a thread */
+enum { BAND_SIZE = 256 * 1024 };
+
+enum { FILTER_NONE, FILTER_SUB, FILTER_UP, FILTER_AVERAGE, FILTER_PAETH,
+    FILTER_COUNT };
+
+struct PngBand {
+    int y0, y1;
+    unsigned char *out;
+    size_t outLen;
+    uLong adler;
+    uLong inLen;
+    bool failed; /* out of memory, reported by scrotPngWrite() */
+};
+
+struct PngJob {
+    const uint32_t *data;
+    int w, h, level;
+    size_t bpp, rowBytes;
+    struct PngBand *bands;
+    size_t bandCount;
+};
+
+static void unpackRow(unsigned char *dst, const uint32_t *src, int w,
+    size_t bpp)
+{
+    for (int x = 0; x < w; ++x, dst += bpp) {
+        const uint32_t p = src[x];
+        dst[0] = p >> 16;
+        dst[1] = p >> 8;
+        dst[2] = p;
+        if (bpp == 4)
+            dst[3] = p >> 24;
+    }
+}
+
+static unsigned char paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return a;
+    return pb <= pc ? b : c;
+}
+
+static void applyFilter(unsigned char *out, int type, const unsigned char *cur,
+    const unsigned char *prev, size_t n, size_t bpp)
+{
+    for (size_t i = 0; i < n; ++i) {
+        const int a = i >= bpp ? cur[i - bpp] : 0;
+        const int b = prev[i];
+        const int c = i >= bpp ? prev[i - bpp] : 0;
+        switch (type) {
+        case FILTER_NONE:    out[i] = cur[i]; break;
+        case FILTER_SUB:     out[i] = cur[i] - a; break;
+        case FILTER_UP:      out[i] = cur[i] - b; break;
+        case FILTER_AVERAGE: out[i] = cur[i] - (a + b) / 2; break;
+        case FILTER_PAETH:   out[i] = cur[i] - paeth(a, b, c); break;
+        }
+    }
+}
+
+/* Filters one row into out, which gets the filter type byte first. Like
+ * libpng, the filter giving the lowest sum of absolute (signed) differences
+ * is used. Level 0 doesn't compress, so filtering would be wasted time. */
+static void filterRow(unsigned char *out, unsigned char *scratch,
+    const unsigned char *cur, const unsigned char *prev, size_t n, size_t bpp,
+    int level)
+{
+    if (level == 0) {
+        out[0] = FILTER_NONE;
+        memcpy(out + 1, cur, n);
+        return;
+    }
+    unsigned long bestSum = ULONG_MAX;
+    for (int type = 0; type < FILTER_COUNT; ++type) {
+        applyFilter(scratch, type, cur, prev, n, bpp);
+        unsigned long sum = 0;
+        for (size_t i = 0; i < n; ++i)
+            sum += scratch[i] < 128 ? scratch[i] : 256 - scratch[i];
+        if (sum < bestSum) {
+            bestSum = sum;
+            out[0] = type;
+            memcpy(out + 1, scratch, n);
+        }
+    }
+}
+
+/* Runs on the workers, so failures are flagged instead of exiting. */
+static void pngCompressBand(void *ctx, size_t i, int worker)
+{
+    (void)worker;
+    const struct PngJob *job = ctx;
+    struct PngBand *band = job->bands + i;
+    const size_t rowBytes = job->rowBytes, lineBytes = rowBytes + 1;
+
+    /* the rows before the band that make up the dictionary */
+    int dictRows = (DICT_SIZE + lineBytes - 1) / lineBytes;
+    int y0 = MAX(band->y0 - dictRows, 0);
+    size_t dictLen = (band->y0 - y0) * lineBytes;
+
+    unsigned char *rows = calloc(3, rowBytes);
+    unsigned char *filtered = calloc(band->y1 - y0, lineBytes);
+    if (!rows || !filtered) {
+        free(rows);
+        free(filtered);
+        band->failed = true;
+        return;
+    }
+    unsigned char *prev = rows, *cur = rows + rowBytes;
+    unsigned char *scratch = rows + rowBytes * 2;
+    if (y0 > 0)
+        unpackRow(prev, job->data + (size_t)(y0 - 1) * job->w, job->w, job->bpp);
+    for (int y = y0; y < band->y1; ++y) {
+        unpackRow(cur, job->data + (size_t)y * job->w, job->w, job->bpp);
+        filterRow(filtered + (y - y0) * lineBytes, scratch, cur, prev,
+            rowBytes, job->bpp, job->level);
+        unsigned char *tmp = prev;
+        prev = cur;
+        cur = tmp;
+    }
+    free(rows);
+
+    const unsigned char *in = filtered + dictLen;
+    band->inLen = (band->y1 - band->y0) * lineBytes;
+    band->adler = adler32(adler32(0, NULL, 0), in, band->inLen);
+
+    z_stream zs = { 0 };
+    if (deflateInit2(&zs, job->level, Z_DEFLATED, -15, 8,
+        Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(filtered);
+        band->failed = true;
+        return;
+    }
+    if (dictLen > 0) {
+        size_t n = MIN(dictLen, DICT_SIZE);
+        deflateSetDictionary(&zs, in - n, n);
+    }
+    /* a sync flush ends the band on a byte boundary without marking the
+     * stream as finished, so the next band's data can simply follow it */
+    const bool isLast = i + 1 == job->bandCount;
+    uLong cap = deflateBound(&zs, band->inLen) + 16;
+    band->out = calloc(cap, 1);
+    if (band->out) {
+        zs.next_in = in;
+        zs.avail_in = band->inLen;
+        zs.next_out = band->out;
+        zs.avail_out = cap;
+        int ret = deflate(&zs, isLast ? Z_FINISH : Z_SYNC_FLUSH);
+        band->failed = ret != (isLast ? Z_STREAM_END : Z_OK)
+            || zs.avail_in != 0;
+        band->outLen = cap - zs.avail_out;
+    } else {
+        band->failed = true;
+    }
+    deflateEnd(&zs);
+    free(filtered);
+}
+
+static void putBE32(unsigned char *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static bool writeChunk(int fd, const char type[static 4],
+    const unsigned char *data, size_t len)
+{
+    unsigned char head[8], tail[4];
+    putBE32(head, len);
+    memcpy(head + 4, type, 4);
+    uLong crc = crc32(crc32(0, NULL, 0), head + 4, 4);
+    if (len > 0) /* crc32() with NULL data returns the initial value */
+        crc = crc32(crc, data, len);
+    putBE32(tail, crc);
+    return writeAll(fd, head, sizeof(head)) && writeAll(fd, data, len)
+        && writeAll(fd, tail, sizeof(tail));
+}
+
+bool scrotPngWrite(int fd, const uint32_t *data, int w, int h, bool hasAlpha,
+    int level, int quality)
+{
+    (void)quality;
+    struct PngJob job = {
+        .data = data, .w = w, .h = h, .bpp = hasAlpha ? 4 : 3,
+        .level = level,
+    };
+    job.rowBytes = (size_t)w * job.bpp;
+    const int bandRows = MAX(BAND_SIZE / (job.rowBytes + 1), 1);
+    job.bandCount = (h + bandRows - 1) / bandRows;
+    job.bands = ecalloc(job.bandCount, sizeof(*job.bands));
+    for (int y = 0, i = 0; y < h; y += bandRows, ++i) {
+        job.bands[i].y0 = y;
+        job.bands[i].y1 = MIN(y + bandRows, h);
+    }
+    parallelFor(job.bandCount, parallelWorkers(job.bandCount),
+        pngCompressBand, &job);
+
+    static const unsigned char signature[8] = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'
+    };
+    unsigned char ihdr[13] = { [8] = 8, [9] = hasAlpha ? 6 : 2 };
+    putBE32(ihdr, w);
+    putBE32(ihdr + 4, h);
+    /* the zlib header, FLEVEL as zlib itself would set it */
+    const int flevel = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+    unsigned char zhead[2] = { 0x78, flevel << 6 };
+    zhead[1] += 31 - (zhead[0] * 256 + zhead[1]) % 31;
+
+    /* deflate can only fail for lack of memory */
+    bool ok = true;
+    for (size_t i = 0; i < job.bandCount; ++i)
+        ok = ok && !job.bands[i].failed;
+    if (!ok)
+        errno = ENOMEM;
+
+    uLong adler = adler32(0, NULL, 0);
+    ok = ok && writeAll(fd, signature, sizeof(signature))
+        && writeChunk(fd, "IHDR", ihdr, sizeof(ihdr))
+        && writeChunk(fd, "IDAT", zhead, sizeof(zhead));
+    for (size_t i = 0; i < job.bandCount; ++i) {
+        const struct PngBand *band = job.bands + i;
+        ok = ok && writeChunk(fd, "IDAT", band->out, band->outLen);
+        adler = adler32_combine(adler, band->adler, band->inLen);
+        free(band->out);
+    }
+    unsigned char ztail[4];
+    putBE32(ztail, adler);
+    ok = ok && writeChunk(fd, "IDAT", ztail, sizeof(ztail))
+        && writeChunk(fd, "IEND", NULL, 0);
+    free(job.bands);
+    return ok;
+}
@@ -0,0 +1,237 @@
+/* scrot_query.c
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/*
+    This file is part of the scrot project.
+    Window queries that have to be made for many windows at once. They go
+    through the connection's xcb side, so that every request is sent before
+    the first reply is waited for and the whole batch costs one round trip.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/shape.h>
+#include <xcb/xcb.h>
+#include <xcb/xproto.h>
+
+#include "scrot_query.h"
+#include "util.h"
+
+/* Appends the children of each of the n windows to *next, returning the new
+ * count. Windows that went away in the meantime are skipped. */
+static size_t queryChildren(xcb_connection_t *c, const xcb_window_t *windows,
+    size_t n, xcb_window_t **next)
+{
+    xcb_query_tree_cookie_t *cookies = ecalloc(n ? n : 1, sizeof(*cookies));
+    size_t count = 0, cap = 0;
+
+    for (size_t i = 0; i < n; ++i)
+        cookies[i] = xcb_query_tree(c, windows[i]);
+    for (size_t i = 0; i < n; ++i) {
+        xcb_generic_error_t *e = NULL;
+        xcb_query_tree_reply_t *r = xcb_query_tree_reply(c, cookies[i], &e);
+        free(e);
+        if (!r)
+            continue;
+        const xcb_window_t *children = xcb_query_tree_children(r);
+        size_t len = xcb_query_tree_children_length(r);
+        if (count + len > cap) {
+            cap = MAX(cap * 2, count + len);
+            *next = erealloc(*next, cap * sizeof(**next));
+        }
+        memcpy(*next + count, children, len * sizeof(*children));
+        count += len;
+        free(r);
+    }
+    free(cookies);
+    return count;
+}
+
+/* Returns the first descendant of window that has the property set. The tree
+ * is searched a level at a time, with the requests for a whole level sent at
+ * once. */
+Window scrotQueryFindByProperty(Display *dpy, Window window, Atom property)
+{
+    xcb_connection_t *c = XGetXCBConnection(dpy);
+    xcb_window_t *level = ecalloc(1, sizeof(*level)), *next = NULL;
+    size_t n = 1;
+    Window found = None;
+
+    level[0] = window;
+    while (found == None && (n = queryChildren(c, level, n, &next)) > 0) {
+        xcb_get_property_cookie_t *cookies = ecalloc(n, sizeof(*cookies));
+        for (size_t i = 0; i < n; ++i) {
+            cookies[i] = xcb_get_property(c, 0, next[i], property,
+                XCB_GET_PROPERTY_TYPE_ANY, 0, 0);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (found != None) {
+                xcb_discard_reply(c, cookies[i].sequence);
+                continue;
+            }
+            xcb_generic_error_t *e = NULL;
+            xcb_get_property_reply_t *r = xcb_get_property_reply(c, cookies[i], &e);
+            free(e);
+            if (r && r->type != XCB_NONE)
+                found = next[i];
+            free(r);
+        }
+        free(cookies);
+
+        xcb_window_t *tmp = level;
+        level = next;
+        next = tmp;
+    }
+    free(level);
+    free(next);
+    return found;
+}
+
+/* WM_CLASS holds the instance and class names as two NUL terminated
+ * strings, the class being the second one. */
+static bool isClass(const xcb_get_property_reply_t *r, const char *class)
+{
+    if (r->type != XCB_ATOM_STRING || r->format != 8)
+        return false;
+    const char *value = xcb_get_property_value(r);
+    size_t len = xcb_get_property_value_length(r);
+    size_t nameLen = strnlen(value, len);
+    if (nameLen == len)
+        return false;
+    const char *res = value + nameLen + 1;
+    size_t resLen = strnlen(res, len - nameLen - 1);
+    return resLen == strlen(class) && memcmp(res, class, resLen) == 0;
+}
+
+/* Fills info[i] for each of the n windows. If class isn't NULL, also checks
+ * whether their WM_CLASS class name is class. */
+void scrotQueryWindows(Display *dpy, const Window *windows, size_t n,
+    const char *class, struct WindowInfo *info)
+{
+    xcb_connection_t *c = XGetXCBConnection(dpy);
+    xcb_get_window_attributes_cookie_t *attrs = ecalloc(n ? n : 1, sizeof(*attrs));
+    xcb_get_geometry_cookie_t *geoms = ecalloc(n ? n : 1, sizeof(*geoms));
+    xcb_get_property_cookie_t *classes = ecalloc(n ? n : 1, sizeof(*classes));
+
+    for (size_t i = 0; i < n; ++i) {
+        attrs[i] = xcb_get_window_attributes(c, windows[i]);
+        geoms[i] = xcb_get_geometry(c, windows[i]);
+        if (class) {
+            classes[i] = xcb_get_property(c, 0, windows[i], XCB_ATOM_WM_CLASS,
+                XCB_ATOM_STRING, 0, 2048);
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        xcb_generic_error_t *e = NULL;
+        xcb_get_window_attributes_reply_t *a =
+            xcb_get_window_attributes_reply(c, attrs[i], &e);
+        free(e);
+        xcb_get_geometry_reply_t *g = xcb_get_geometry_reply(c, geoms[i], &e);
+        free(e);
+        xcb_get_property_reply_t *p = NULL;
+        if (class) {
+            p = xcb_get_property_reply(c, classes[i], &e);
+            free(e);
+        }
+
+        info[i] = (struct WindowInfo){ .ok = a && g };
+        if (info[i].ok) {
+            info[i].x = g->x;
+            info[i].y = g->y;
+            info[i].w = g->width;
+            info[i].h = g->height;
+            info[i].borderWidth = g->border_width;
+            info[i].isViewable = a->map_state == XCB_MAP_STATE_VIEWABLE;
+            info[i].isInputOnly = a->_class == XCB_WINDOW_CLASS_INPUT_ONLY;
+            info[i].isClassMatch = !class || (p && isClass(p, class));
+        }
+        free(a);
+        free(g);
+        free(p);
+    }
+    free(attrs);
+    free(geoms);
+    free(classes);
+}
+
+/* Fetches the input shape of each of the n windows, the part of it that
+ * takes clicks, relative to the inside corner of its border: rects[i] gets
+ * counts[i] rectangles, none if the window went away. Returns false and
+ * leaves them alone if the server has no input shapes, SHAPE 1.1. */
+bool scrotQueryInputShapes(Display *dpy, const Window *windows, size_t n,
+    XRectangle **rects, int *counts)
+{
+    xcb_connection_t *c = XGetXCBConnection(dpy);
+    const xcb_query_extension_reply_t *ext =
+        xcb_get_extension_data(c, &xcb_shape_id);
+    if (!ext || !ext->present)
+        return false;
+
+    /* the version is asked along with the shapes, an older server only
+     * answers those with errors */
+    xcb_shape_query_version_cookie_t version = xcb_shape_query_version(c);
+    xcb_shape_get_rectangles_cookie_t *cookies =
+        ecalloc(n ? n : 1, sizeof(*cookies));
+    for (size_t i = 0; i < n; ++i)
+        cookies[i] = xcb_shape_get_rectangles(c, windows[i], XCB_SHAPE_SK_INPUT);
+
+    xcb_generic_error_t *e = NULL;
+    xcb_shape_query_version_reply_t *v =
+        xcb_shape_query_version_reply(c, version, &e);
+    free(e);
+    const bool hasInput = v && (v->major_version > 1
+        || (v->major_version == 1 && v->minor_version >= 1));
+    free(v);
+
+    for (size_t i = 0; i < n; ++i) {
+        if (!hasInput) {
+            xcb_discard_reply(c, cookies[i].sequence);
+            continue;
+        }
+        xcb_shape_get_rectangles_reply_t *r =
+            xcb_shape_get_rectangles_reply(c, cookies[i], &e);
+        free(e);
+        rects[i] = NULL;
+        counts[i] = 0;
+        if (!r)
+            continue;
+        const xcb_rectangle_t *shape = xcb_shape_get_rectangles_rectangles(r);
+        counts[i] = xcb_shape_get_rectangles_rectangles_length(r);
+        rects[i] = ecalloc(counts[i] ? counts[i] : 1, sizeof(**rects));
+        for (int k = 0; k < counts[i]; ++k) {
+            rects[i][k] = (XRectangle){
+                shape[k].x, shape[k].y, shape[k].width, shape[k].height
+            };
+        }
+        free(r);
+    }
+    free(cookies);
+    return hasInput;
+}
@@ -36,7 +36,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <err.h>
 #include <errno.h>
+#include <poll.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -44,6 +46,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <Imlib2.h>
 #include <X11/Xlib.h>
 #include <X11/cursorfont.h>
+#include <X11/extensions/Xfixes.h>
+#include <X11/extensions/Xpresent.h>
+#include <X11/extensions/Xrandr.h>
+#include <X11/extensions/shape.h>
 #include <X11/keysym.h>
 
 #include "options.h"
@@ -51,6 +57,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "scrot_selection.h"
 #include "selection_classic.h"
 #include "selection_edge.h"
+#include "selection_index.h"
 #include "util.h"
 
 static void scrotSelectionCreate(void);
@@ -59,6 +66,7 @@ static void scrotSelectionMotionDraw(int, int, int, int);
 static bool scrotSelectionGetUserSel(struct SelectionRect *);
 
 struct Selection selection;
+static Window freezeWindow = None;
 
 static void createCursors(void)
 {
@@ -122,6 +130,14 @@ static void scrotSelectionCreate(void)
 
     createCursors();
 
+    sel->canvas = freezeWindow != None ? freezeWindow : root;
+
+    XRRScreenConfiguration *conf = XRRGetScreenInfo(disp, root);
+    short rate = conf ? XRRConfigCurrentRate(conf) : 0;
+    if (conf)
+        XRRFreeScreenConfigInfo(conf);
+    sel->motion.frameMs = 1000 / (rate > 0 ? rate : 60);
+
     if (opt.lineMode == LINE_MODE_CLASSIC) {
         sel->create = selectionClassicCreate;
         sel->draw = selectionClassicDraw;
@@ -137,6 +153,8 @@ static void scrotSelectionCreate(void)
         scrotAssert(0);
     }
 
+    /* before create(), so that the selection's own windows aren't in it */
+    selectionIndexBuild(freezeWindow);
     sel->create();
 
     unsigned int const EVENT_MASK = ButtonMotionMask | ButtonPressMask | ButtonReleaseMask;
@@ -156,22 +174,105 @@ static void scrotSelectionCreate(void)
     }
 }
 
+static Bool isPresentComplete(Display *dpy, XEvent *ev, XPointer arg)
+{
+    (void)dpy;
+    const int *opcode = (const int *)arg;
+    return ev->type == GenericEvent && ev->xcookie.extension == *opcode
+        && ev->xcookie.evtype == PresentCompleteNotify;
+}
+
+static int msLeft(struct timespec start, int budget)
+{
+    struct timespec now = clockNow();
+    long ms = budget - (now.tv_sec - start.tv_sec) * 1000
+        - (now.tv_nsec - start.tv_nsec) / 1000000;
+    return ms > 0 ? ms : 0;
+}
+
+/* Waits for the PresentCompleteNotify event with the given serial, storing
+ * the MSC it completed at. Returns false if it didn't come within budget ms of
+ * start. */
+static bool waitPresentComplete(int opcode, uint32_t serial, uint64_t *msc,
+    struct timespec start, int budget)
+{
+    for (;;) {
+        XEvent ev;
+        while (XCheckIfEvent(disp, &ev, isPresentComplete, (XPointer)&opcode)) {
+            bool found = false;
+            if (XGetEventData(disp, &ev.xcookie)) {
+                const XPresentCompleteNotifyEvent *ce = ev.xcookie.data;
+                if (ce->serial_number == serial) {
+                    *msc = ce->msc;
+                    found = true;
+                }
+                XFreeEventData(disp, &ev.xcookie);
+            }
+            if (found)
+                return true;
+        }
+        int timeout = msLeft(start, budget);
+        if (timeout == 0)
+            return false;
+        struct pollfd pfd = { .fd = ConnectionNumber(disp), .events = POLLIN };
+        if (poll(&pfd, 1, timeout) < 0 && errno != EINTR)
+            return false;
+    }
+}
+
+/* Waits until a compositor has presented a frame without the selection on
+ * it. Returns false if there's no compositor running or if it could not be
+ * waited on, in which case the caller has to fall back to guessing. */
+static bool selectionWaitFramePresented(struct timespec start, int budget)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "_NET_WM_CM_S%d", XScreenNumberOfScreen(scr));
+    if (XGetSelectionOwner(disp, XInternAtom(disp, name, False)) == None)
+        return false;
+
+    int opcode, eventBase, errorBase;
+    if (!XPresentQueryExtension(disp, &opcode, &eventBase, &errorBase))
+        return false;
+
+    XID eid = XPresentSelectInput(disp, root, PresentCompleteNotifyMask);
+    /* the first notify completes right away with the current MSC. the
+     * compositor repaints the damage left by the selection on the next
+     * vblank, and may keep that frame queued for one more, so wait for the
+     * second vblank after it. */
+    uint64_t msc = 0;
+    bool ok = false;
+    XPresentNotifyMSC(disp, root, 1, 0, 0, 0);
+    XFlush(disp);
+    if (waitPresentComplete(opcode, 1, &msc, start, budget)) {
+        XPresentNotifyMSC(disp, root, 2, msc + 2, 0, 0);
+        XFlush(disp);
+        ok = waitPresentComplete(opcode, 2, &msc, start, budget);
+    }
+    XPresentFreeInput(disp, root, eid);
+    return ok;
+}
+
 static void scrotSelectionDestroy(void)
 {
     XUngrabPointer(disp, CurrentTime);
     freeCursors();
     selection.destroy();
+    selectionIndexFree();
     XSync(disp, False);
-    /* HACK: although we destroyed the selection, the frame still might not
-     * have been updated. a compositor might also buffer frames adding
-     * latency. so wait a bit for the screen to update and the selection
-     * borders to go away. */
-    scrotSleepFor(clockNow(), 80);
+    /* although we destroyed the selection, the frame still might not have
+     * been updated. with a compositor, wait for it to present a new frame.
+     * otherwise (or if that fails) wait a bit for the screen to update and
+     * the selection borders to go away. */
+    struct timespec start = clockNow();
+    if (!selectionWaitFramePresented(start, 100))
+        scrotSleepFor(start, 80);
 }
 
-static void scrotSelectionMotionDraw(int x0, int y0, int x1, int y1)
+static void scrotSelectionFlushMotion(void)
 {
-    const struct Selection *const sel = &selection;
+    struct Selection *const sel = &selection;
+    struct SelectionMotion *const m = &sel->motion;
+    const int x0 = m->x0, y0 = m->y0, x1 = m->x1, y1 = m->y1;
     const unsigned int EVENT_MASK = ButtonMotionMask | ButtonPressMask | ButtonReleaseMask;
     Cursor cursor = None;
 
@@ -185,6 +286,39 @@ static void scrotSelectionMotionDraw(int x0, int y0, int x1, int y1)
         cursor = sel->curAngleNW;
     XChangeActivePointerGrab(disp, EVENT_MASK, cursor, CurrentTime);
     sel->motionDraw(x0, y0, x1, y1);
+    m->lastDraw = clockNow();
+    m->isPending = false;
+}
+
+/* Motion is only drawn once per frame interval, anything in between would
+ * never make it to the screen anyway. If it's too early, the motion is kept
+ * pending and selectionNextEvent() draws it once it's due.
+ */
+static void scrotSelectionMotionDraw(int x0, int y0, int x1, int y1)
+{
+    struct SelectionMotion *const m = &selection.motion;
+
+    if (opt.snap)
+        selectionIndexSnap(&x1, &y1, opt.snap);
+    *m = (struct SelectionMotion){ x0, y0, x1, y1, true, m->lastDraw,
+        m->frameMs };
+    if (msLeft(m->lastDraw, m->frameMs) == 0)
+        scrotSelectionFlushMotion();
+}
+
+/* XNextEvent(), but draws the pending motion if it's due before an event
+ * arrives. */
+static void selectionNextEvent(XEvent *ev)
+{
+    const struct SelectionMotion *const m = &selection.motion;
+
+    while (m->isPending && XEventsQueued(disp, QueuedAfterFlush) == 0) {
+        int timeout = msLeft(m->lastDraw, m->frameMs);
+        struct pollfd pfd = { .fd = ConnectionNumber(disp), .events = POLLIN };
+        if (timeout == 0 || poll(&pfd, 1, timeout) == 0)
+            scrotSelectionFlushMotion();
+    }
+    XNextEvent(disp, ev);
 }
 
 XColor scrotSelectionGetLineColor(void)
@@ -225,9 +359,18 @@ static bool scrotSelectionGetUserSel(struct SelectionRect *selectionRect)
     }
 
     while (done == WAIT) {
-        XNextEvent(disp, &ev);
+        selectionNextEvent(&ev);
         switch (ev.type) {
         case MotionNotify:
+            /* only the latest position matters, so skip over the motion
+             * events already queued up behind this one. */
+            while (XEventsQueued(disp, QueuedAfterReading) > 0) {
+                XEvent next;
+                XPeekEvent(disp, &next);
+                if (next.type != MotionNotify)
+                    break;
+                XNextEvent(disp, &ev);
+            }
             if (isButtonPressed)
                 scrotSelectionMotionDraw(rx, ry, ev.xmotion.x, ev.xmotion.y);
             break;
@@ -237,7 +380,14 @@ static bool scrotSelectionGetUserSel(struct SelectionRect *selectionRect)
                 buttonId = ev.xbutton.button;
                 rx = ev.xbutton.x;
                 ry = ev.xbutton.y;
-                target = scrotGetWindow(disp, ev.xbutton.subwindow, ev.xbutton.x, ev.xbutton.y);
+                if (opt.snap)
+                    selectionIndexSnap(&rx, &ry, opt.snap);
+                /* scrotGetGeometry() goes up to the top-level window anyway
+                 * and only needs to know how deep the click was for -b. */
+                if (opt.border)
+                    target = scrotGetWindow(disp, ev.xbutton.subwindow, ev.xbutton.x, ev.xbutton.y);
+                else
+                    target = selectionIndexHit(ev.xbutton.x, ev.xbutton.y);
                 if (target == None)
                     target = root;
             } else {
@@ -301,7 +451,9 @@ static bool scrotSelectionGetUserSel(struct SelectionRect *selectionRect)
             break;
         }
     }
-    selection.draw();
+    /* the area check below needs the latest rect */
+    if (selection.motion.isPending)
+        scrotSelectionFlushMotion();
 
     XUngrabKeyboard(disp, CurrentTime);
 
@@ -314,13 +466,16 @@ static bool scrotSelectionGetUserSel(struct SelectionRect *selectionRect)
 
     if (isAreaSelect) {
         /* If a rect has been drawn, it's an area selection */
-        rw = ev.xbutton.x - rx;
-        rh = ev.xbutton.y - ry;
+        int ex = ev.xbutton.x, ey = ev.xbutton.y;
+        if (opt.snap)
+            selectionIndexSnap(&ex, &ey, opt.snap);
+        rw = ex - rx;
+        rh = ey - ry;
 
-        if ((ev.xbutton.x + 1) == WidthOfScreen(scr))
+        if ((ex + 1) == WidthOfScreen(scr))
             ++rw;
 
-        if ((ev.xbutton.y + 1) == HeightOfScreen(scr))
+        if ((ey + 1) == HeightOfScreen(scr))
             ++rh;
 
         if (rw < 0) {
@@ -396,6 +551,36 @@ static Imlib_Image loadImage(const char *const fileName, const int opacity)
     return image;
 }
 
+/* --freeze: cover the screen with a window showing `capture`, so that the
+ * screen looks frozen without keeping the server grabbed. The window lets the
+ * pointer through, clicks still reach the windows under it.
+ */
+static Window selectionFreezeScreen(Imlib_Image capture)
+{
+    Pixmap pixmap = None, mask = None;
+    imlib_context_set_image(capture);
+    imlib_render_pixmaps_for_whole_image(&pixmap, &mask);
+    if (!pixmap)
+        errx(EXIT_FAILURE, "Failed to render the frozen screen");
+
+    XSetWindowAttributes attr = {
+        .background_pixmap = pixmap,
+        .override_redirect = True,
+    };
+    Window win = XCreateWindow(disp, root, 0, 0, scr->width, scr->height, 0,
+        CopyFromParent, InputOutput, CopyFromParent,
+        CWBackPixmap | CWOverrideRedirect, &attr);
+    /* the server keeps its own reference to the background */
+    imlib_free_pixmap_and_mask(pixmap);
+
+    XserverRegion empty = XFixesCreateRegion(disp, NULL, 0);
+    XFixesSetWindowShapeRegion(disp, win, ShapeInput, 0, 0, empty);
+    XFixesDestroyRegion(disp, empty);
+
+    XMapRaised(disp, win);
+    return win;
+}
+
 Imlib_Image scrotSelectionSelectMode(void)
 {
     struct SelectionRect rect0, rect1;
@@ -418,12 +603,16 @@ Imlib_Image scrotSelectionSelectMode(void)
         scrotDoDelay();
 
     if (opt.freeze) {
+        /* Only hold the grab until the capture is on screen, so that nothing
+         * can change in between. Other clients keep running afterwards. */
         XGrabServer(disp);
         // capture immidately to avoid the selection making a mess later
-        capture = imlib_create_image_from_drawable(0, 0, 0,
-            scr->width, scr->height, false);
+        capture = scrotGrabRect(0, 0, scr->width, scr->height);
         if (!capture)
             errx(EXIT_FAILURE, "Failed to grab image");
+        freezeWindow = selectionFreezeScreen(capture);
+        XUngrabServer(disp);
+        XSync(disp, False);
     }
 
     bool selected = scrotSelectionGetUserSel(&rect0);
@@ -440,7 +629,8 @@ Imlib_Image scrotSelectionSelectMode(void)
     }
 
     if (opt.freeze) {
-        XUngrabServer(disp);
+        XDestroyWindow(disp, freezeWindow);
+        freezeWindow = None;
         XFlush(disp);
         // captured already, just crop it
         imlib_context_set_image(capture);
@@ -454,7 +644,13 @@ Imlib_Image scrotSelectionSelectMode(void)
         if (capture && opt.pointer)
             scrotGrabMousePointer(capture, rect0.x, rect0.y);
     } else if (selected) {
-        capture = scrotGrabRectAndPointer(rect0.x, rect0.y, rect0.w, rect0.h);
+        /* clientWindow is only set when a window was clicked */
+        if (opt.composite && clientWindow != None
+            && opt.selection.mode == SELECTION_MODE_CAPTURE)
+            capture = scrotGrabWindowComposite(clientWindow);
+        if (!capture)
+            capture = scrotGrabRectAndPointer(rect0.x, rect0.y, rect0.w,
+                rect0.h);
     }
 
     if (capture == NULL) {
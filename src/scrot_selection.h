@@ -36,6 +36,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define H_SCROT_SELECTION
 
 #include <stdbool.h>
+#include <time.h>
 
 #include <Imlib2.h>
 #include <X11/Xlib.h>
@@ -87,9 +88,13 @@ typedef struct SelectionMode {
 struct SelectionClassic {
     XGCValues gcValues;
     GC gc;
+    struct SelectionRect drawn; // what's currently on screen
+    /* without --freeze: the outline is a shaped window instead */
+    Window window;
+    bool isMapped;
 };
 struct SelectionEdge {
-    Window windows[4];
+    Window window;
     bool isMapped;
 };
 
@@ -99,6 +104,15 @@ struct Selection {
     struct SelectionRect rect;
     struct SelectionClassic classic;
     struct SelectionEdge edge;
+    Window canvas; // where the classic mode draws
+
+    /* the latest motion, drawn at most once per frameMs */
+    struct SelectionMotion {
+        int x0, y0, x1, y1;
+        bool isPending;
+        struct timespec lastDraw;
+        int frameMs;
+    } motion;
 
     void (*create)(void);
     void (*destroy)(void);
@@ -0,0 +1,151 @@
+/* scrot_shm.c
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/*
+    This file is part of the scrot project.
+    Grabbing through a MIT-SHM segment avoids pushing the whole image through
+    the X socket, which dominates capture time on large screens.
+*/
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+#include "scrot_shm.h"
+#include "util.h"
+
+static bool shmError;
+
+static int shmErrorHandler(Display *dpy, XErrorEvent *ev)
+{
+    (void)dpy;
+    (void)ev;
+    shmError = true;
+    return 0;
+}
+
+/* The server can only attach to our segment if it runs on the same machine.
+ * Remote connections (including ssh forwarding) are always over TCP, so
+ * checking the socket family is enough to rule those out cheaply.
+ */
+static bool scrotShmIsLocal(Display *dpy)
+{
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(ConnectionNumber(dpy), (struct sockaddr *)&addr, &len) < 0)
+        return false;
+    return addr.ss_family == AF_UNIX;
+}
+
+static bool scrotShmAttach(struct ShmImage *shm, Display *dpy, size_t size)
+{
+    scrotShmDestroy(shm, dpy);
+
+    shm->info.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (shm->info.shmid < 0)
+        return false;
+    shm->info.shmaddr = shmat(shm->info.shmid, NULL, 0);
+    if (shm->info.shmaddr == (char *)-1) {
+        shmctl(shm->info.shmid, IPC_RMID, NULL);
+        return false;
+    }
+    shm->info.readOnly = False;
+
+    /* XShmAttach can still fail, e.g when the server lives in a different
+     * IPC namespace, and the error is only reported asynchronously. */
+    shmError = false;
+    XErrorHandler oldHandler = XSetErrorHandler(shmErrorHandler);
+    Status ok = XShmAttach(dpy, &shm->info);
+    XSync(dpy, False);
+    XSetErrorHandler(oldHandler);
+
+    /* Mark the segment for removal right away, it will be released once both
+     * us and the server have detached from it, even if we crash. */
+    shmctl(shm->info.shmid, IPC_RMID, NULL);
+    if (!ok || shmError) {
+        shmdt(shm->info.shmaddr);
+        return false;
+    }
+    shm->size = size;
+    shm->attached = true;
+    return true;
+}
+
+/* Grab the given rectangle of drawable `d` through the shared segment.
+ * Returns NULL if MIT-SHM can't be used, in which case the caller should fall
+ * back to XGetImage() or similar. The returned image points into the segment
+ * and is only valid until the next call, free it with XDestroyImage().
+ */
+XImage *scrotShmGetImage(struct ShmImage *shm, Display *dpy, Drawable d,
+    Visual *vis, int depth, int x, int y, int w, int h)
+{
+    if (shm->disabled)
+        return NULL;
+    if (!shm->attached && (!XShmQueryExtension(dpy) || !scrotShmIsLocal(dpy))) {
+        shm->disabled = true;
+        return NULL;
+    }
+
+    XImage *ximage = XShmCreateImage(dpy, vis, depth, ZPixmap, NULL,
+        &shm->info, w, h);
+    if (!ximage)
+        return NULL;
+
+    size_t size = (size_t)ximage->bytes_per_line * ximage->height;
+    if (size > shm->size && !scrotShmAttach(shm, dpy, size)) {
+        shm->disabled = true;
+        XDestroyImage(ximage);
+        return NULL;
+    }
+    ximage->data = shm->info.shmaddr;
+
+    shmError = false;
+    XErrorHandler oldHandler = XSetErrorHandler(shmErrorHandler);
+    Status ok = XShmGetImage(dpy, d, ximage, x, y, AllPlanes);
+    XSetErrorHandler(oldHandler);
+    if (!ok || shmError) {
+        XDestroyImage(ximage);
+        return NULL;
+    }
+    return ximage;
+}
+
+void scrotShmDestroy(struct ShmImage *shm, Display *dpy)
+{
+    if (!shm->attached)
+        return;
+    XShmDetach(dpy, &shm->info);
+    XSync(dpy, False);
+    shmdt(shm->info.shmaddr);
+    shm->attached = false;
+    shm->size = 0;
+}
@@ -0,0 +1,49 @@
+/* scrot_shm.h
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef H_SCROT_SHM
+#define H_SCROT_SHM
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/XShm.h>
+
+/* A MIT-SHM segment that can be reused across captures. The segment is only
+ * reallocated when a capture needs more memory than it currently holds.
+ */
+struct ShmImage {
+    XShmSegmentInfo info;
+    size_t size;
+    bool attached;
+    bool disabled;
+};
+
+XImage *scrotShmGetImage(struct ShmImage *, Display *, Drawable, Visual *,
+    int, int, int, int, int);
+void scrotShmDestroy(struct ShmImage *, Display *);
+
+#endif /* !defined(H_SCROT_SHM) */
@@ -0,0 +1,167 @@
+/* scrot_stream.c
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/*
+    This file is part of the scrot project.
+    --stream: write every grabbed frame to stdout, uncompressed, paced at
+    --fps. Either as a YUV4MPEG2 stream or as BGRA frames each preceded by a
+    small header.
+*/
+
+#include <err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "options.h"
+#include "scrot.h"
+#include "scrot_stream.h"
+#include "scrot_yuv.h"
+#include "util.h"
+
+static struct {
+    bool started;
+    struct timespec start;
+    long long framesWritten;
+    /* y4m: the frame size is fixed by the first frame */
+    int w, h;
+    unsigned char *planes;
+    size_t planesSize;
+} stream;
+
+static long long nsSince(struct timespec t)
+{
+    struct timespec now = clockNow();
+    return (now.tv_sec - t.tv_sec) * 1000000000LL + (now.tv_nsec - t.tv_nsec);
+}
+
+static void streamWrite(const void *p, size_t n)
+{
+    if (!writeAll(1, p, n))
+        err(EXIT_FAILURE, "option --stream: write failed");
+}
+
+static void putLE(unsigned char *p, uint64_t v, int n)
+{
+    for (int i = 0; i < n; ++i)
+        p[i] = v >> (i * 8);
+}
+
+static void streamY4m(const uint32_t *data, int w, int h, long long count)
+{
+    const int cw = (stream.w + 1) / 2, ch = (stream.h + 1) / 2;
+    const size_t ySize = (size_t)stream.w * stream.h, cSize = (size_t)cw * ch;
+
+    if (!stream.planes) {
+        char head[128];
+        int len = snprintf(head, sizeof(head),
+            "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n",
+            stream.w, stream.h, opt.fps);
+        streamWrite(head, len);
+        stream.planesSize = ySize + cSize * 2;
+        stream.planes = ecalloc(stream.planesSize, 1);
+    }
+    unsigned char *py = stream.planes, *pu = py + ySize, *pv = pu + cSize;
+    /* a y4m stream can't change size, so pad with black or crop */
+    if (w != stream.w || h != stream.h) {
+        memset(py, 16, ySize);
+        memset(pu, 128, cSize * 2);
+    }
+    /* y4m can't say which matrix it uses, so follow what players guess from
+     * the size: BT.709 for HD, BT.601 below */
+    const struct Yuv420 dst = { py, pu, pv, stream.w, cw };
+    scrotYuvFromArgb(data, w, MIN(w, stream.w), MIN(h, stream.h),
+        stream.h >= 720 ? YUV_BT709 : YUV_BT601, false, &dst);
+    /* frames that are late are repeated, so the stream stays in real time */
+    for (long long i = 0; i < count; ++i) {
+        streamWrite("FRAME\n", 6);
+        streamWrite(stream.planes, stream.planesSize);
+    }
+}
+
+/* Each frame: "BGRA", width and height as 32 bit little endian numbers, the
+ * time the frame was grabbed in microseconds since the stream started as a
+ * 64 bit little endian number, then width * height 8 bit B, G, R, A pixels.
+ */
+static void streamBgra(const uint32_t *data, int w, int h, long long ns)
+{
+    unsigned char head[20] = { 'B', 'G', 'R', 'A' };
+    putLE(head + 4, w, 4);
+    putLE(head + 8, h, 4);
+    putLE(head + 12, ns / 1000, 8);
+    streamWrite(head, sizeof(head));
+
+    const uint32_t one = 1;
+    unsigned char isLittleEndian;
+    memcpy(&isLittleEndian, &one, 1);
+    if (isLittleEndian) {
+        streamWrite(data, (size_t)w * h * sizeof(*data));
+        return;
+    }
+    unsigned char *row = ecalloc(w, 4);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x)
+            putLE(row + x * 4, data[(size_t)y * w + x], 4);
+        streamWrite(row, (size_t)w * 4);
+    }
+    free(row);
+}
+
+void scrotStreamFrame(const uint32_t *data, int w, int h)
+{
+    if (!stream.started) {
+        stream.started = true;
+        stream.start = clockNow();
+        stream.w = w;
+        stream.h = h;
+    }
+    const long long ns = nsSince(stream.start);
+    const long long period = 1000000000LL / opt.fps;
+
+    if (opt.stream == STREAM_Y4M) {
+        long long count = ns / period + 1 - stream.framesWritten;
+        count = MAX(count, 1);
+        streamY4m(data, w, h, count);
+        stream.framesWritten += count;
+    } else {
+        streamBgra(data, w, h, ns);
+        stream.framesWritten++;
+    }
+}
+
+/* Sleep until the next frame is due. If grabbing took longer than a frame,
+ * the frames that were missed are skipped rather than rushed. */
+void scrotStreamWait(void)
+{
+    const long long period = 1000000000LL / opt.fps;
+    const long long ns = nsSince(stream.start);
+    const long long next = (ns / period + 1) * period;
+    const int ms = (next - ns + 999999) / 1000000;
+
+    scrotSleepFor(clockNow(), ms);
+}
@@ -0,0 +1,344 @@
+/* scrot_yuv.c
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+/*
+    This file is part of the scrot project.
+
+    Converts ARGB32 pixels to 4:2:0 YCbCr, for the y4m stream and the JPEG
+    writer. Both BT.601 and BT.709, in limited (16-235) or full range. Chroma
+    is taken from the mean of each 2x2 block.
+
+    The coefficients are 8 bit fixed point, so the SSE2 and AVX2 kernels work
+    on 16 bit lanes and give the same bytes as the scalar code.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "scrot_yuv.h"
+#include "util.h"
+
+#if HAVE_X86_SIMD
+    #include <immintrin.h>
+#endif
+
+/* Weights of red, green and blue, scaled by 256. The luma weights add up to
+ * the range of Y, the chroma weights add up to 0 so that grays have no
+ * chroma. */
+struct YuvCoef {
+    int16_t y[3], u[3], v[3];
+    int16_t yOffset;
+};
+
+static const struct YuvCoef coefs[2][2] = {
+    [YUV_BT601] = {
+        { { 66, 129, 25 }, { -38, -74, 112 }, { 112, -94, -18 }, 16 },
+        { { 77, 150, 29 }, { -43, -85, 128 }, { 128, -107, -21 }, 0 },
+    },
+    [YUV_BT709] = {
+        { { 47, 157, 16 }, { -26, -86, 112 }, { 112, -102, -10 }, 16 },
+        { { 54, 184, 18 }, { -29, -99, 128 }, { 128, -116, -12 }, 0 },
+    },
+};
+
+/* Converts a pair of rows. y1 is NULL if row1 is row0 repeated past the
+ * bottom of an image of odd height. */
+typedef void YuvRowsFunc(const uint32_t *, const uint32_t *, int,
+    unsigned char *, unsigned char *, unsigned char *, unsigned char *,
+    const struct YuvCoef *);
+
+static unsigned char lumaOf(uint32_t p, const struct YuvCoef *c)
+{
+    const int r = (p >> 16) & 0xff, g = (p >> 8) & 0xff, b = p & 0xff;
+    return ((c->y[0] * r + c->y[1] * g + c->y[2] * b + 128) >> 8) + c->yOffset;
+}
+
+/* Rounds like the SIMD kernels, which halve the sum to keep it in 16 bits:
+ * full range blue would overflow otherwise. */
+static unsigned char chromaOf(int r, int g, int b, const int16_t k[3])
+{
+    const int sum = k[0] * r + k[1] * g + k[2] * b;
+    return MIN((((sum + 32768) >> 1) + 64) >> 7, 255);
+}
+
+static void yuvRows(const uint32_t *row0, const uint32_t *row1, int w,
+    unsigned char *y0, unsigned char *y1, unsigned char *u, unsigned char *v,
+    const struct YuvCoef *c)
+{
+    for (int x = 0; x < w; x += 2) {
+        const int x1 = x + 1 < w ? x + 1 : x;
+        const uint32_t q[4] = { row0[x], row0[x1], row1[x], row1[x1] };
+        y0[x] = lumaOf(q[0], c);
+        y0[x1] = lumaOf(q[1], c);
+        if (y1) {
+            y1[x] = lumaOf(q[2], c);
+            y1[x1] = lumaOf(q[3], c);
+        }
+        int r = 0, g = 0, b = 0;
+        for (int i = 0; i < 4; ++i) {
+            r += (q[i] >> 16) & 0xff;
+            g += (q[i] >> 8) & 0xff;
+            b += q[i] & 0xff;
+        }
+        r = (r + 2) >> 2;
+        g = (g + 2) >> 2;
+        b = (b + 2) >> 2;
+        if (v) {
+            u[x / 2] = chromaOf(r, g, b, c->u);
+            v[x / 2] = chromaOf(r, g, b, c->v);
+        } else {
+            u[x] = chromaOf(r, g, b, c->u);
+            u[x + 1] = chromaOf(r, g, b, c->v);
+        }
+    }
+}
+
+#if HAVE_X86_SIMD
+
+/* Splits 8 pixels into red, green and blue 16 bit lanes. */
+SSE2 static inline void unpackSse2(const uint32_t *p, __m128i rgb[3])
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i a = _mm_loadu_si128((const __m128i *)p);
+    const __m128i b = _mm_loadu_si128((const __m128i *)(p + 4));
+    rgb[0] = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a, 16), mask),
+        _mm_and_si128(_mm_srli_epi32(b, 16), mask));
+    rgb[1] = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a, 8), mask),
+        _mm_and_si128(_mm_srli_epi32(b, 8), mask));
+    rgb[2] = _mm_packs_epi32(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+}
+
+SSE2 static inline __m128i dotSse2(const __m128i rgb[3], const __m128i k[3])
+{
+    return _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(rgb[0], k[0]),
+                             _mm_mullo_epi16(rgb[1], k[1])),
+        _mm_mullo_epi16(rgb[2], k[2]));
+}
+
+/* The luma sum can reach 65408, it is treated as unsigned. */
+SSE2 static inline __m128i lumaSse2(const __m128i rgb[3], const __m128i k[3],
+    __m128i offset)
+{
+    const __m128i sum = _mm_add_epi16(dotSse2(rgb, k), _mm_set1_epi16(128));
+    return _mm_add_epi16(_mm_srli_epi16(sum, 8), offset);
+}
+
+SSE2 static inline __m128i chromaSse2(const __m128i rgb[3],
+    const __m128i k[3])
+{
+    const __m128i half = _mm_add_epi16(_mm_srai_epi16(dotSse2(rgb, k), 1),
+        _mm_set1_epi16(16448));
+    return _mm_srli_epi16(half, 7);
+}
+
+/* The rounded means of the 2x2 blocks of 16 pixels, given the sums of the
+ * two rows. */
+SSE2 static inline __m128i meanSse2(__m128i a, __m128i b)
+{
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i sum = _mm_packs_epi32(_mm_madd_epi16(a, one),
+        _mm_madd_epi16(b, one));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+SSE2 static void yuvRowsSse2(const uint32_t *row0, const uint32_t *row1,
+    int w, unsigned char *y0, unsigned char *y1, unsigned char *u,
+    unsigned char *v, const struct YuvCoef *c)
+{
+    __m128i ky[3], ku[3], kv[3];
+    for (int i = 0; i < 3; ++i) {
+        ky[i] = _mm_set1_epi16(c->y[i]);
+        ku[i] = _mm_set1_epi16(c->u[i]);
+        kv[i] = _mm_set1_epi16(c->v[i]);
+    }
+    const __m128i offset = _mm_set1_epi16(c->yOffset);
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        __m128i a0[3], b0[3], a1[3], b1[3], mean[3];
+        unpackSse2(row0 + x, a0);
+        unpackSse2(row0 + x + 8, b0);
+        unpackSse2(row1 + x, a1);
+        unpackSse2(row1 + x + 8, b1);
+        _mm_storeu_si128((__m128i *)(y0 + x),
+            _mm_packus_epi16(lumaSse2(a0, ky, offset),
+                lumaSse2(b0, ky, offset)));
+        if (y1) {
+            _mm_storeu_si128((__m128i *)(y1 + x),
+                _mm_packus_epi16(lumaSse2(a1, ky, offset),
+                    lumaSse2(b1, ky, offset)));
+        }
+        for (int i = 0; i < 3; ++i) {
+            mean[i] = meanSse2(_mm_add_epi16(a0[i], a1[i]),
+                _mm_add_epi16(b0[i], b1[i]));
+        }
+        const __m128i uv = _mm_packus_epi16(chromaSse2(mean, ku),
+            chromaSse2(mean, kv));
+        if (v) {
+            _mm_storel_epi64((__m128i *)(u + x / 2), uv);
+            _mm_storel_epi64((__m128i *)(v + x / 2), _mm_srli_si128(uv, 8));
+        } else {
+            _mm_storeu_si128((__m128i *)(u + x),
+                _mm_unpacklo_epi8(uv, _mm_srli_si128(uv, 8)));
+        }
+    }
+    yuvRows(row0 + x, row1 + x, w - x, y0 + x, y1 ? y1 + x : NULL,
+        v ? u + x / 2 : u + x, v ? v + x / 2 : NULL, c);
+}
+
+/* The AVX2 versions work on 16 pixels at a time. Packing works within each
+ * 128 bit half, so the results are put back in order with a permute. */
+AVX2 static inline void unpackAvx2(const uint32_t *p, __m256i rgb[3])
+{
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m256i a = _mm256_loadu_si256((const __m256i *)p);
+    const __m256i b = _mm256_loadu_si256((const __m256i *)(p + 8));
+    rgb[0] = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(a, 16), mask),
+        _mm256_and_si256(_mm256_srli_epi32(b, 16), mask));
+    rgb[1] = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(a, 8), mask),
+        _mm256_and_si256(_mm256_srli_epi32(b, 8), mask));
+    rgb[2] = _mm256_packs_epi32(_mm256_and_si256(a, mask),
+        _mm256_and_si256(b, mask));
+    for (int i = 0; i < 3; ++i)
+        rgb[i] = _mm256_permute4x64_epi64(rgb[i], 0xd8);
+}
+
+AVX2 static inline __m256i dotAvx2(const __m256i rgb[3], const __m256i k[3])
+{
+    return _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(rgb[0], k[0]),
+                                _mm256_mullo_epi16(rgb[1], k[1])),
+        _mm256_mullo_epi16(rgb[2], k[2]));
+}
+
+AVX2 static inline __m256i lumaAvx2(const __m256i rgb[3], const __m256i k[3],
+    __m256i offset)
+{
+    const __m256i sum = _mm256_add_epi16(dotAvx2(rgb, k),
+        _mm256_set1_epi16(128));
+    return _mm256_add_epi16(_mm256_srli_epi16(sum, 8), offset);
+}
+
+AVX2 static inline __m256i chromaAvx2(const __m256i rgb[3],
+    const __m256i k[3])
+{
+    const __m256i half = _mm256_add_epi16(
+        _mm256_srai_epi16(dotAvx2(rgb, k), 1), _mm256_set1_epi16(16448));
+    return _mm256_srli_epi16(half, 7);
+}
+
+AVX2 static inline __m256i meanAvx2(__m256i a, __m256i b)
+{
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i sum = _mm256_packs_epi32(_mm256_madd_epi16(a, one),
+        _mm256_madd_epi16(b, one));
+    return _mm256_srli_epi16(_mm256_add_epi16(
+                                 _mm256_permute4x64_epi64(sum, 0xd8),
+                                 _mm256_set1_epi16(2)),
+        2);
+}
+
+AVX2 static inline __m256i packBytesAvx2(__m256i a, __m256i b)
+{
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+}
+
+AVX2 static void yuvRowsAvx2(const uint32_t *row0, const uint32_t *row1,
+    int w, unsigned char *y0, unsigned char *y1, unsigned char *u,
+    unsigned char *v, const struct YuvCoef *c)
+{
+    __m256i ky[3], ku[3], kv[3];
+    for (int i = 0; i < 3; ++i) {
+        ky[i] = _mm256_set1_epi16(c->y[i]);
+        ku[i] = _mm256_set1_epi16(c->u[i]);
+        kv[i] = _mm256_set1_epi16(c->v[i]);
+    }
+    const __m256i offset = _mm256_set1_epi16(c->yOffset);
+    int x = 0;
+    for (; x + 32 <= w; x += 32) {
+        __m256i a0[3], b0[3], a1[3], b1[3], mean[3];
+        unpackAvx2(row0 + x, a0);
+        unpackAvx2(row0 + x + 16, b0);
+        unpackAvx2(row1 + x, a1);
+        unpackAvx2(row1 + x + 16, b1);
+        _mm256_storeu_si256((__m256i *)(y0 + x),
+            packBytesAvx2(lumaAvx2(a0, ky, offset), lumaAvx2(b0, ky, offset)));
+        if (y1) {
+            _mm256_storeu_si256((__m256i *)(y1 + x),
+                packBytesAvx2(lumaAvx2(a1, ky, offset),
+                    lumaAvx2(b1, ky, offset)));
+        }
+        for (int i = 0; i < 3; ++i) {
+            mean[i] = meanAvx2(_mm256_add_epi16(a0[i], a1[i]),
+                _mm256_add_epi16(b0[i], b1[i]));
+        }
+        /* 16 U bytes then 16 V bytes */
+        const __m256i uv = packBytesAvx2(chromaAvx2(mean, ku),
+            chromaAvx2(mean, kv));
+        const __m128i pu = _mm256_castsi256_si128(uv);
+        const __m128i pv = _mm256_extracti128_si256(uv, 1);
+        if (v) {
+            _mm_storeu_si128((__m128i *)(u + x / 2), pu);
+            _mm_storeu_si128((__m128i *)(v + x / 2), pv);
+        } else {
+            _mm_storeu_si128((__m128i *)(u + x), _mm_unpacklo_epi8(pu, pv));
+            _mm_storeu_si128((__m128i *)(u + x + 16),
+                _mm_unpackhi_epi8(pu, pv));
+        }
+    }
+    yuvRowsSse2(row0 + x, row1 + x, w - x, y0 + x, y1 ? y1 + x : NULL,
+        v ? u + x / 2 : u + x, v ? v + x / 2 : NULL, c);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+/* Converts the w * h pixels at src, rows srcStride pixels apart, to dst. */
+void scrotYuvFromArgb(const uint32_t *src, size_t srcStride, int w, int h,
+    enum YuvMatrix matrix, bool fullRange, const struct Yuv420 *dst)
+{
+    const struct YuvCoef *c = &coefs[matrix][fullRange];
+    YuvRowsFunc *rows = yuvRows;
+#if HAVE_X86_SIMD
+    switch (cpuLevel()) {
+    case CPU_AVX2:
+        rows = yuvRowsAvx2;
+        break;
+    case CPU_SSE2:
+        rows = yuvRowsSse2;
+        break;
+    case CPU_SCALAR:
+        break;
+    }
+#endif
+    for (int y = 0; y < h; y += 2) {
+        const uint32_t *row0 = src + y * srcStride;
+        const bool isPair = y + 1 < h;
+        unsigned char *y0 = dst->y + y * dst->yStride;
+        unsigned char *u = dst->u + y / 2 * dst->cStride;
+        unsigned char *v = dst->v ? dst->v + y / 2 * dst->cStride : NULL;
+        rows(row0, isPair ? row0 + srcStride : row0, w, y0,
+            isPair ? y0 + dst->yStride : NULL, u, v, c);
+    }
+}
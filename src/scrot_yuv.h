@@ -0,0 +1,51 @@
+/* scrot_yuv.h
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+/*
+    This file is part of the scrot project.
+*/
+
+#ifndef H_SCROT_YUV
+#define H_SCROT_YUV
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum YuvMatrix { YUV_BT601, YUV_BT709 };
+
+/* The planes of a 4:2:0 image: the chroma planes are (w + 1) / 2 by
+ * (h + 1) / 2 samples. If v is NULL, the image is NV12 and u holds U and V
+ * interleaved, cStride being the length of such a row in bytes. */
+struct Yuv420 {
+    unsigned char *y, *u, *v;
+    size_t yStride, cStride;
+};
+
+void scrotYuvFromArgb(const uint32_t *, size_t, int, int, enum YuvMatrix,
+    bool, const struct Yuv420 *);
+
+#endif /* !defined(H_SCROT_YUV) */
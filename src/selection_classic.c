@@ -29,12 +29,21 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 /*
     This file is part of the scrot project.
     Part of the code comes from the scrot.c file and maintains its authorship.
+
+    With --freeze, the outline is XORed onto the freeze window, which nothing
+    repaints. Otherwise, drawing on the root window would leave stale outlines
+    behind whenever a window repaints under them, and compositors don't show
+    it at all. The outline is then a window of the line color instead, shaped
+    down to the rectangle, which the compositor presents like any other.
 */
 
 #include <stdlib.h>
 #include <err.h>
 
+#include <X11/Xatom.h>
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/shape.h>
 
 #include "options.h"
 #include "scrot.h"
@@ -62,7 +71,7 @@ void selectionClassicCreate(void)
     if (color.pixel != blackColor)
         pc->gcValues.foreground = color.pixel;
 
-    pc->gc = XCreateGC(disp, root,
+    pc->gc = XCreateGC(disp, sel->canvas,
         GCFunction | GCForeground | GCBackground | GCSubwindowMode,
         &pc->gcValues);
     if (pc->gc == NULL)
@@ -70,25 +79,116 @@ void selectionClassicCreate(void)
 
     XSetLineAttributes(disp, pc->gc, opt.lineWidth, opt.lineStyle, CapRound,
         JoinRound);
+
+    if (sel->canvas != root)
+        return;
+
+    XSetWindowAttributes attr;
+    attr.background_pixel = pc->gcValues.foreground;
+    attr.override_redirect = True;
+    Atom winType = XInternAtom(disp, "_NET_WM_WINDOW_TYPE", False);
+    Atom winDock = XInternAtom(disp, "_NET_WM_WINDOW_TYPE_DOCK", False);
+
+    /* empty until the first draw */
+    pc->window = XCreateWindow(disp, root, 0, 0, 1, 1, 0, CopyFromParent,
+        InputOutput, CopyFromParent, CWOverrideRedirect | CWBackPixel, &attr);
+    XShapeCombineRectangles(disp, pc->window, ShapeBounding, 0, 0, NULL, 0,
+        ShapeSet, Unsorted);
+    XChangeProperty(disp, pc->window, winType, XA_ATOM, 32, PropModeReplace,
+        (unsigned char *)&winDock, 1L);
+    XClassHint hint = { .res_name = "scrot", .res_class = "scrot" };
+    XSetClassHint(disp, pc->window, &hint);
+    pc->isMapped = false;
+}
+
+/* Appends the pieces of a side of the outline to rects: the whole side, or
+ * the 4 pixel dashes X draws by default. `len` runs along x if horizontal. */
+static int classicSide(XRectangle *rects, int x, int y, int len, int lw,
+    bool horizontal)
+{
+    const int dash = opt.lineStyle == LineSolid ? len : 4;
+    int n = 0;
+    for (int s = 0; s < len; s += dash * 2) {
+        const int d = MIN(dash, len - s);
+        rects[n++] = horizontal ? (XRectangle){ x + s, y, d, lw }
+                                : (XRectangle){ x, y + s, lw, d };
+    }
+    return n;
 }
 
+/* Shapes the outline window to sel->rect: a frame lw pixels wide centered on
+ * the rectangle, like a line drawn along it. The shape is set in one request
+ * before the window is moved, so that the frame never shows half updated. */
+static void classicShapeWindow(void)
+{
+    struct Selection *const sel = &selection;
+    struct SelectionClassic *const pc = &sel->classic;
+    const int lw = opt.lineWidth;
+    const int w = sel->rect.w + lw, h = sel->rect.h + lw;
+    const int side = MAX(h - lw * 2, 0);
+
+    /* at most one piece every 8 pixels, plus a partial one per side */
+    XRectangle *rects = ecalloc((w + side) / 4 + 4, sizeof(*rects));
+    int n = classicSide(rects, 0, 0, w, lw, true);
+    n += classicSide(rects + n, 0, h - lw, w, lw, true);
+    if (side > 0) {
+        n += classicSide(rects + n, 0, lw, side, lw, false);
+        n += classicSide(rects + n, w - lw, lw, side, lw, false);
+    }
+    XShapeCombineRectangles(disp, pc->window, ShapeBounding, 0, 0, rects, n,
+        ShapeSet, Unsorted);
+    free(rects);
+
+    XMoveResizeWindow(disp, pc->window, sel->rect.x - lw / 2,
+        sel->rect.y - lw / 2, w, h);
+    if (!pc->isMapped) {
+        XMapWindow(disp, pc->window);
+        pc->isMapped = true;
+    }
+}
+
+/* Brings the screen up to date with sel->rect. The outline on screen is
+ * erased and the new one drawn in a single request, as XORing it twice
+ * restores what was under it. That way there's no frame with neither.
+ */
 void selectionClassicDraw(void)
 {
-    const struct Selection *const sel = &selection;
-    const struct SelectionClassic *const pc = &sel->classic;
-    XDrawRectangle(disp, root, pc->gc, sel->rect.x, sel->rect.y, sel->rect.w,
-        sel->rect.h);
-    XFlush(disp);
+    struct Selection *const sel = &selection;
+    struct SelectionClassic *const pc = &sel->classic;
+    XRectangle rects[2];
+    int n = 0;
+
+    if (pc->window != None) {
+        if (sel->rect.w && sel->rect.h)
+            classicShapeWindow();
+        return;
+    }
+    if (pc->drawn.w) {
+        rects[n++] = (XRectangle){ pc->drawn.x, pc->drawn.y, pc->drawn.w,
+            pc->drawn.h };
+    }
+    if (sel->rect.w) {
+        rects[n++] = (XRectangle){ sel->rect.x, sel->rect.y, sel->rect.w,
+            sel->rect.h };
+    }
+    if (n > 0)
+        XDrawRectangles(disp, sel->canvas, pc->gc, rects, n);
+    pc->drawn = sel->rect;
 }
 
 void selectionClassicMotionDraw(int x0, int y0, int x1, int y1)
 {
-    const struct Selection *const sel = &selection;
-
-    if (sel->rect.w)
-        selectionClassicDraw();
     selectionCalculateRect(x0, y0, x1, y1);
     selectionClassicDraw();
+    XFlush(disp);
+}
+
+static Bool isClassicDestroyNotify(Display *dpy, XEvent *ev, XPointer arg)
+{
+    (void)dpy;
+    (void)arg;
+    return ev->type == DestroyNotify
+        && ev->xdestroywindow.window == selection.classic.window;
 }
 
 void selectionClassicDestroy(void)
@@ -96,6 +196,21 @@ void selectionClassicDestroy(void)
     const struct Selection *const sel = &selection;
     const struct SelectionClassic *pc = &sel->classic;
 
-    if (pc->gc)
+    if (pc->window != None) {
+        XSelectInput(disp, pc->window, StructureNotifyMask);
+        XDestroyWindow(disp, pc->window);
+        /* so the outline is gone before the shot. other events are left in
+         * the queue */
+        XEvent ev;
+        XIfEvent(disp, &ev, isClassicDestroyNotify, NULL);
+        XFreeGC(disp, pc->gc);
+        return;
+    }
+    if (pc->gc) {
+        if (pc->drawn.w) {
+            XDrawRectangle(disp, sel->canvas, pc->gc, pc->drawn.x,
+                pc->drawn.y, pc->drawn.w, pc->drawn.h);
+        }
         XFreeGC(disp, pc->gc);
+    }
 }
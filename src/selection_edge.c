@@ -38,6 +38,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <X11/Xatom.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/extensions/shape.h>
 
 #include "options.h"
 #include "scrot.h"
@@ -58,49 +59,52 @@ void selectionEdgeCreate(void)
     Atom winDock = XInternAtom(disp, "_NET_WM_WINDOW_TYPE_DOCK", False);
     Atom winOpacity = XInternAtom(disp, "_NET_WM_WINDOW_OPACITY", False);
 
-    for (size_t i = 0; i < ARRAY_COUNT(pe->windows); ++i) {
-        pe->windows[i] = XCreateWindow(disp, root,
-            0, 0, WidthOfScreen(scr), HeightOfScreen(scr), 0,
-            CopyFromParent, InputOutput, CopyFromParent,
-            CWOverrideRedirect | CWBackPixel, &attr);
+    /* A single window covering the selection, shaped down to its outline.
+     * It starts with an empty shape so nothing shows before the first draw. */
+    pe->window = XCreateWindow(disp, root, 0, 0, 1, 1, 0,
+        CopyFromParent, InputOutput, CopyFromParent,
+        CWOverrideRedirect | CWBackPixel, &attr);
+    XShapeCombineRectangles(disp, pe->window, ShapeBounding, 0, 0, NULL, 0,
+        ShapeSet, Unsorted);
 
-        XChangeProperty(disp, pe->windows[i], winType, XA_ATOM, 32,
-            PropModeReplace, (unsigned char *)&winDock, 1L);
+    XChangeProperty(disp, pe->window, winType, XA_ATOM, 32,
+        PropModeReplace, (unsigned char *)&winDock, 1L);
 
-        unsigned long opacity = opt.lineOpacity * (0xFFFFFFFFu / 255);
-        XChangeProperty(disp, pe->windows[i], winOpacity, XA_CARDINAL, 32,
-            PropModeReplace, (unsigned char *)&opacity, 1L);
+    unsigned long opacity = opt.lineOpacity * (0xFFFFFFFFu / 255);
+    XChangeProperty(disp, pe->window, winOpacity, XA_CARDINAL, 32,
+        PropModeReplace, (unsigned char *)&opacity, 1L);
 
-        XClassHint hint = { .res_name = "scrot", .res_class = "scrot" };
-        XSetClassHint(disp, pe->windows[i], &hint);
-    }
-    pe->isMapped = false;
+    XClassHint hint = { .res_name = "scrot", .res_class = "scrot" };
+    XSetClassHint(disp, pe->window, &hint);
 
+    pe->isMapped = false;
 }
 
 void selectionEdgeDraw(void)
 {
     struct Selection *const sel = &selection;
     struct SelectionEdge *const pe = &sel->edge;
+    const int w = sel->rect.w, h = sel->rect.h, lw = opt.lineWidth;
 
     XRectangle rects[4] = {
-        { sel->rect.x, sel->rect.y + opt.lineWidth,
-            opt.lineWidth, sel->rect.h - opt.lineWidth }, // left
-        { sel->rect.x, sel->rect.y, sel->rect.w, opt.lineWidth }, // top
-        { sel->rect.x + sel->rect.w, sel->rect.y, opt.lineWidth, sel->rect.h }, // right
-        { sel->rect.x, sel->rect.y + sel->rect.h, sel->rect.w + opt.lineWidth,
-            opt.lineWidth } // bottom
+        { 0, lw, lw, h - lw }, // left
+        { 0, 0, w, lw }, // top
+        { w, 0, lw, h }, // right
+        { 0, h, w + lw, lw } // bottom
     };
 
-    if (sel->rect.w == 0 || sel->rect.h == 0)
+    if (w == 0 || h == 0)
         return;
 
-    for (size_t i = 0; i < ARRAY_COUNT(pe->windows); ++i) {
-        XRectangle *rp = rects + i;
-        XMoveResizeWindow(disp, pe->windows[i], rp->x, rp->y, rp->width, rp->height);
-        XMapWindow(disp, pe->windows[i]);
+    /* shape before resizing, so that growing the window never exposes its
+     * whole area filled with the background for a frame. */
+    XShapeCombineRectangles(disp, pe->window, ShapeBounding, 0, 0, rects,
+        ARRAY_COUNT(rects), ShapeSet, Unsorted);
+    XMoveResizeWindow(disp, pe->window, sel->rect.x, sel->rect.y, w + lw, h + lw);
+    if (!pe->isMapped) {
+        XMapWindow(disp, pe->window);
+        pe->isMapped = true;
     }
-    pe->isMapped = true;
 }
 
 void selectionEdgeMotionDraw(int x0, int y0, int x1, int y1)
@@ -117,22 +121,26 @@ void selectionEdgeMotionDraw(int x0, int y0, int x1, int y1)
     selectionEdgeDraw();
 }
 
+static Bool isEdgeNotify(Display *dpy, XEvent *ev, XPointer arg)
+{
+    (void)dpy;
+    (void)arg;
+    const Window w = selection.edge.window;
+
+    return (ev->type == DestroyNotify && ev->xdestroywindow.window == w)
+        || (ev->type == UnmapNotify && ev->xunmap.window == w);
+}
+
 void selectionEdgeDestroy(void)
 {
     const struct SelectionEdge *pe = &selection.edge;
 
-    for (size_t i = 0; i < ARRAY_COUNT(pe->windows); ++i) {
-        if (pe->windows[i] == None)
-            continue;
-        XSelectInput(disp, pe->windows[i], StructureNotifyMask);
-        XDestroyWindow(disp, pe->windows[i]);
-        bool isUnmapped = !pe->isMapped, isDestroyed = false;
-        for (XEvent ev; !(isUnmapped && isDestroyed);) {
-            XNextEvent(disp, &ev);
-            if (ev.type == DestroyNotify && ev.xdestroywindow.window == pe->windows[i])
-                isDestroyed = true;
-            if (ev.type == UnmapNotify && ev.xunmap.window == pe->windows[i])
-                isUnmapped = true;
-        }
-    }
+    if (pe->window == None)
+        return;
+    XSelectInput(disp, pe->window, StructureNotifyMask);
+    XDestroyWindow(disp, pe->window);
+    /* the UnmapNotify of a mapped window always comes before its
+     * DestroyNotify. other events are left in the queue. */
+    for (XEvent ev = { 0 }; ev.type != DestroyNotify;)
+        XIfEvent(disp, &ev, isEdgeNotify, NULL);
 }
@@ -0,0 +1,193 @@
+/* selection_index.c
+
+Copyright 2026      scrot contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies of the Software and its documentation and acknowledgment shall be
+given in the documentation and software packages that this Software was
+used.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/*
+    This file is part of the scrot project.
+    Keeps a snapshot of the top-level windows taken when a selection starts,
+    so that clicks and snapping can be resolved without asking the X server.
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <X11/Xlib.h>
+
+#include "scrot.h"
+#include "scrot_query.h"
+#include "selection_index.h"
+#include "util.h"
+
+struct IndexedWindow {
+    Window window;
+    int x0, y0, x1, y1; // x1 and y1 are exclusive, borders included
+    int borderWidth;
+    XRectangle *input; // the parts that take clicks, see takesInput()
+    int inputCount;
+};
+
+/* the viewable top-level windows, from the bottom of the stack to the top */
+static struct IndexedWindow *windows;
+static size_t windowCount;
+/* whether the server has input shapes, SHAPE 1.1 */
+static bool hasInputShape;
+
+void selectionIndexBuild(Window skip)
+{
+    Window rootReturn, parent, *children = NULL;
+    unsigned int childCount = 0;
+
+    selectionIndexFree();
+    if (!XQueryTree(disp, root, &rootReturn, &parent, &children, &childCount))
+        return;
+    struct WindowInfo *info = ecalloc(childCount ? childCount : 1, sizeof(*info));
+    scrotQueryWindows(disp, children, childCount, NULL, info);
+    windows = ecalloc(childCount ? childCount : 1, sizeof(*windows));
+    for (unsigned int i = 0; i < childCount; ++i) {
+        const struct WindowInfo *wi = info + i;
+        if (children[i] == skip || !wi->ok || !wi->isViewable
+            || wi->isInputOnly)
+            continue;
+        const int bw = wi->borderWidth;
+        windows[windowCount++] = (struct IndexedWindow){
+            .window = children[i], .x0 = wi->x, .y0 = wi->y,
+            .x1 = wi->x + wi->w + bw * 2, .y1 = wi->y + wi->h + bw * 2,
+            .borderWidth = bw,
+        };
+    }
+    free(info);
+    XFree(children);
+
+    Window *ids = ecalloc(windowCount ? windowCount : 1, sizeof(*ids));
+    XRectangle **input = ecalloc(windowCount ? windowCount : 1, sizeof(*input));
+    int *inputCount = ecalloc(windowCount ? windowCount : 1, sizeof(*inputCount));
+    for (size_t i = 0; i < windowCount; ++i)
+        ids[i] = windows[i].window;
+    hasInputShape = scrotQueryInputShapes(disp, ids, windowCount, input,
+        inputCount);
+    for (size_t i = 0; hasInputShape && i < windowCount; ++i) {
+        windows[i].input = input[i];
+        windows[i].inputCount = inputCount[i];
+    }
+    free(ids);
+    free(input);
+    free(inputCount);
+}
+
+void selectionIndexFree(void)
+{
+    for (size_t i = 0; i < windowCount; ++i)
+        free(windows[i].input);
+    free(windows);
+    windows = NULL;
+    windowCount = 0;
+}
+
+static bool isInside(const struct IndexedWindow *w, int x, int y)
+{
+    return x >= w->x0 && x < w->x1 && y >= w->y0 && y < w->y1;
+}
+
+static const struct IndexedWindow *hit(int x, int y)
+{
+    for (size_t i = windowCount; i-- > 0;) {
+        if (isInside(windows + i, x, y))
+            return windows + i;
+    }
+    return NULL;
+}
+
+/* Whether a click at (x, y) reaches w. Overlays such as the Composite
+ * Overlay Window let clicks through with an empty or partial input shape. */
+static bool takesInput(const struct IndexedWindow *w, int x, int y)
+{
+    if (!hasInputShape)
+        return true;
+    /* shapes are relative to the inside corner of the border */
+    x -= w->x0 + w->borderWidth;
+    y -= w->y0 + w->borderWidth;
+    for (int i = 0; i < w->inputCount; ++i) {
+        const XRectangle *r = w->input + i;
+        if (x >= r->x && x < r->x + r->width
+            && y >= r->y && y < r->y + r->height)
+            return true;
+    }
+    return false;
+}
+
+/* The top-most window that a click at (x, y) would go to. */
+Window selectionIndexHit(int x, int y)
+{
+    for (size_t i = windowCount; i-- > 0;) {
+        if (isInside(windows + i, x, y) && takesInput(windows + i, x, y))
+            return windows[i].window;
+    }
+    return None;
+}
+
+/* Moves *v to the nearest edge in [lo, hi) that's visible at the other
+ * coordinate `at`, if one is within `dist`. isX tells which axis v is on.
+ */
+static void snapAxis(int *v, int at, bool isX, int dist, int lo, int hi)
+{
+    int best = *v, bestDist = dist + 1;
+
+    if (abs(*v - lo) < bestDist) {
+        best = lo;
+        bestDist = abs(*v - lo);
+    }
+    if (abs(*v - hi) < bestDist) {
+        best = hi;
+        bestDist = abs(*v - hi);
+    }
+    for (size_t i = 0; i < windowCount; ++i) {
+        const struct IndexedWindow *w = windows + i;
+        const int edges[2] = { isX ? w->x0 : w->y0, isX ? w->x1 : w->y1 };
+        const int span0 = isX ? w->y0 : w->x0, span1 = isX ? w->y1 : w->x1;
+
+        if (at < span0 || at >= span1)
+            continue;
+        for (int e = 0; e < 2; ++e) {
+            int d = abs(*v - edges[e]);
+            if (d >= bestDist)
+                continue;
+            /* only snap to edges that aren't covered by another window. the
+             * pixel just inside the edge has to belong to this window. */
+            int in = e == 0 ? edges[e] : edges[e] - 1;
+            if (hit(isX ? in : at, isX ? at : in) != w)
+                continue;
+            best = edges[e];
+            bestDist = d;
+        }
+    }
+    *v = best;
+}
+
+void selectionIndexSnap(int *x, int *y, int dist)
+{
+    const int x0 = *x, y0 = *y;
+
+    snapAxis(x, y0, true, dist, 0, WidthOfScreen(scr));
+    snapAxis(y, x0, false, dist, 0, HeightOfScreen(scr));
+}
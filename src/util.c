@@ -25,8 +25,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include <err.h>
+#include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "util.h"
 
@@ -82,3 +85,99 @@ void streamStr(Stream *buf, const char *str)
 {
     streamMem(buf, str, strlen(str));
 }
+
+/* Number of workers worth using for `count` items: one per online CPU at most.
+ */
+int parallelWorkers(size_t count)
+{
+    enum { MAX_WORKERS = 16 };
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = MIN(count, MAX_WORKERS);
+    if (cpus > 0 && cpus < workers)
+        workers = cpus;
+    return MAX(workers, 1);
+}
+
+struct Parallel {
+    pthread_mutex_t lock;
+    size_t next, count;
+    ParallelFunc *fn;
+    void *ctx;
+};
+
+struct ParallelWorker {
+    struct Parallel *p;
+    int index;
+};
+
+static void *parallelRun(void *arg)
+{
+    struct ParallelWorker *w = arg;
+    struct Parallel *p = w->p;
+    for (;;) {
+        pthread_mutex_lock(&p->lock);
+        size_t i = p->next++;
+        pthread_mutex_unlock(&p->lock);
+        if (i >= p->count)
+            break;
+        p->fn(p->ctx, i, w->index);
+    }
+    return NULL;
+}
+
+/* Call `fn` for each of the `count` items, spread over `workers` threads. The
+ * calling thread is worker 0 and the call returns once all items are done.
+ */
+void parallelFor(size_t count, int workers, ParallelFunc *fn, void *ctx)
+{
+    struct Parallel p = {
+        .lock = PTHREAD_MUTEX_INITIALIZER, .count = count, .fn = fn,
+        .ctx = ctx,
+    };
+    struct ParallelWorker *w = ecalloc(MAX(workers, 1), sizeof(*w));
+    pthread_t *threads = ecalloc(MAX(workers, 1), sizeof(*threads));
+    int started = 1;
+
+    for (; started < workers; ++started) {
+        w[started] = (struct ParallelWorker){ &p, started };
+        /* if no more threads can be created, the others get more work */
+        if (pthread_create(&threads[started], NULL, parallelRun,
+            &w[started]) != 0)
+            break;
+    }
+    w[0] = (struct ParallelWorker){ &p, 0 };
+    parallelRun(&w[0]);
+    for (int i = 1; i < started; ++i)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_destroy(&p.lock);
+    free(threads);
+    free(w);
+}
+
+bool writeAll(int fd, const void *buf, size_t n)
+{
+    const char *p = buf;
+    while (n > 0) {
+        ssize_t ret = write(fd, p, n);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        p += ret;
+        n -= ret;
+    }
+    return true;
+}
+
+enum CpuLevel cpuLevel(void)
+{
+#if HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return CPU_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return CPU_SSE2;
+#endif
+    return CPU_SCALAR;
+}
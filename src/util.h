@@ -27,6 +27,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #ifndef H_UTIL
 #define H_UTIL
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -41,6 +42,18 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
     #define scrotAssert(X) ((void)0)
 #endif
 
+/* SSE2 and AVX2 kernels are built with the target attribute and picked at
+ * runtime with cpuLevel(), so the rest of the program needs no extra flags.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) \
+    && !defined(__TINYC__)
+    #define HAVE_X86_SIMD 1
+    #define SSE2 __attribute__((target("sse2")))
+    #define AVX2 __attribute__((target("avx2")))
+#else
+    #define HAVE_X86_SIMD 0
+#endif
+
 #define ARRAY_COUNT(X)   (sizeof(X) / sizeof(0[X]))
 #define MAX(A, B)        ((A) > (B) ? (A) : (B))
 #define MIN(A, B)        ((A) < (B) ? (A) : (B))
@@ -50,6 +63,8 @@ typedef struct {
     size_t off, cap;
 } Stream;
 
+enum CpuLevel { CPU_SCALAR, CPU_SSE2, CPU_AVX2 };
+
 char *estrdup(const char *);
 void *ecalloc(size_t, size_t);
 void *erealloc(void *, size_t);
@@ -59,4 +74,14 @@ void streamChar(Stream *, char);
 void streamMem(Stream *, const void *, size_t);
 void streamStr(Stream *, const char *);
 
+/* Called with the context, the index of the item and the index of the worker
+ * (which is < the number of workers) processing it. */
+typedef void ParallelFunc(void *, size_t, int);
+
+int parallelWorkers(size_t);
+void parallelFor(size_t, int, ParallelFunc *, void *);
+
+bool writeAll(int, const void *, size_t);
+enum CpuLevel cpuLevel(void);
+
 #endif /* !defined(H_UTIL) */